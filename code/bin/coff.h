@@ -47,3 +47,79 @@ struct scnhdr {
         long            s_flags;        /* flags */
       };
  
+
+/* The symbol table, at f_symptr: a symbolic header, pointing to the
+ * tables in it.  Only what coff2noff needs, to save the names of the
+ * procedures for the Nachos profiler.
+ */
+
+#define magicSym        0x7009
+
+typedef struct {
+        short   magic;          /* magicSym                             */
+        short   vstamp;         /* version stamp                        */
+        long    ilineMax;       /* line numbers                         */
+        long    cbLine;
+        long    cbLineOffset;
+        long    idnMax;         /* dense numbers                        */
+        long    cbDnOffset;
+        long    ipdMax;         /* procedure descriptors                */
+        long    cbPdOffset;
+        long    isymMax;        /* local symbols                        */
+        long    cbSymOffset;
+        long    ioptMax;        /* optimization symbols                 */
+        long    cbOptOffset;
+        long    iauxMax;        /* auxiliary symbols                    */
+        long    cbAuxOffset;
+        long    issMax;         /* local string space                   */
+        long    cbSsOffset;
+        long    issExtMax;      /* external string space                */
+        long    cbSsExtOffset;
+        long    ifdMax;         /* file descriptors                     */
+        long    cbFdOffset;
+        long    crfd;           /* relative file descriptors            */
+        long    cbRfdOffset;
+        long    iextMax;        /* external symbols                     */
+        long    cbExtOffset;
+      } HDRR;
+
+typedef struct {
+        long    iss;            /* name, as an index into a string space */
+        long    value;          /* for a procedure, its address         */
+        unsigned long bits;     /* st:6, sc:5, reserved:1, index:20     */
+      } SYMR;
+
+#define SymType(s)      ((s).bits & 0x3f)
+#define SymClass(s)     (((s).bits >> 6) & 0x1f)
+
+#define stProc          6       /* symbol types of procedures           */
+#define stStaticProc    14
+#define scText          1       /* storage class: in .text              */
+
+typedef struct {
+        unsigned short  flags;
+        short           ifd;    /* file it was defined in               */
+        SYMR            asym;
+      } EXTR;
+
+typedef struct {
+        long    adr;            /* address of the file's code           */
+        long    rss;            /* its name                             */
+        long    issBase;        /* start of its local strings           */
+        long    cbSs;
+        long    isymBase;       /* start of its local symbols           */
+        long    csym;
+        long    ilineBase;
+        long    cline;
+        long    ioptBase;
+        long    copt;
+        unsigned short  ipdFirst;
+        short   cpd;
+        long    iauxBase;
+        long    caux;
+        long    rfdBase;
+        long    crfd;
+        unsigned long   bits;   /* language, etc.                       */
+        long    cbLineOffset;
+        long    cbLine;
+      } FDR;
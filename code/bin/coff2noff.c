@@ -89,6 +89,91 @@ void Write(int fd, char *buf, int nBytes)
     }
 }
 
+/* Return the "nBytes" at "offset" in the file, in a new buffer */
+char *ReadTable(int fd, long offset, int nBytes)
+{
+    char *buffer = malloc(nBytes + 1);
+
+    lseek(fd, offset, 0);
+    Read(fd, buffer, nBytes);
+    buffer[nBytes] = '\0';
+    return buffer;
+}
+
+/* Save the procedures in the COFF symbol table, if there is one, in 
+ * "<noffFileName>.sym": one line each, the address in hex and the name.
+ * They are not part of the NOFF file; nachos -prof reads them to name 
+ * the functions in its report.
+ */
+void WriteSymbols(int fdIn, long symptr)
+{
+    HDRR symh;
+    EXTR *ext;
+    SYMR *sym;
+    FDR *fdr;
+    char *extStrings, *strings, *symFileName;
+    FILE *out;
+    int i, j;
+
+    if (symptr == 0) {
+        return;			/* stripped */
+    }
+    lseek(fdIn, symptr, 0);
+    ReadStruct(fdIn, symh);
+    if (ShortToHost(symh.magic) != magicSym) {
+        fprintf(stderr, "Unknown symbol table, not saved\n");
+        return;
+    }
+    symFileName = malloc(strlen(noffFileName) + 5);
+    sprintf(symFileName, "%s.sym", noffFileName);
+    out = fopen(symFileName, "w");
+    if (out == NULL) {
+        perror(symFileName);
+        return;
+    }
+
+    /* global procedures */
+    ext = (EXTR *) ReadTable(fdIn, WordToHost(symh.cbExtOffset),
+                             WordToHost(symh.iextMax) * sizeof(EXTR));
+    extStrings = ReadTable(fdIn, WordToHost(symh.cbSsExtOffset), 
+                           WordToHost(symh.issExtMax));
+    for (i = 0; i < WordToHost(symh.iextMax); i++) {
+        ext[i].asym.bits = WordToHost(ext[i].asym.bits);
+        if (SymType(ext[i].asym) == stProc 
+            && SymClass(ext[i].asym) == scText) {
+            fprintf(out, "%x %s\n", WordToHost(ext[i].asym.value),
+                    &extStrings[WordToHost(ext[i].asym.iss)]);
+        }
+    }
+
+    /* static procedures, and the global ones again, file by file */
+    fdr = (FDR *) ReadTable(fdIn, WordToHost(symh.cbFdOffset),
+                            WordToHost(symh.ifdMax) * sizeof(FDR));
+    sym = (SYMR *) ReadTable(fdIn, WordToHost(symh.cbSymOffset),
+                             WordToHost(symh.isymMax) * sizeof(SYMR));
+    strings = ReadTable(fdIn, WordToHost(symh.cbSsOffset), 
+                        WordToHost(symh.issMax));
+    for (i = 0; i < WordToHost(symh.ifdMax); i++) {
+        for (j = WordToHost(fdr[i].isymBase); 
+             j < WordToHost(fdr[i].isymBase) + WordToHost(fdr[i].csym); j++) {
+            sym[j].bits = WordToHost(sym[j].bits);
+            if ((SymType(sym[j]) == stProc || SymType(sym[j]) == stStaticProc)
+                && SymClass(sym[j]) == scText) {
+                fprintf(out, "%x %s\n", WordToHost(sym[j].value),
+                        &strings[WordToHost(fdr[i].issBase) 
+                                 + WordToHost(sym[j].iss)]);
+            }
+        }
+    }
+    fclose(out);
+    free(ext);
+    free(extStrings);
+    free(fdr);
+    free(sym);
+    free(strings);
+    free(symFileName);
+}
+
 main (int argc, char **argv)
 {
     int fdIn, fdOut, numsections, i, inNoffFile;
@@ -122,6 +207,7 @@ main (int argc, char **argv)
     ReadStruct(fdIn,fileh);
     fileh.f_magic = ShortToHost(fileh.f_magic);
     fileh.f_nscns = ShortToHost(fileh.f_nscns); 
+    fileh.f_symptr = WordToHost(fileh.f_symptr);
     if (fileh.f_magic != MIPSELMAGIC) {
 	fprintf(stderr, "File is not a MIPSEL COFF file\n");
         unlink(noffFileName);
@@ -221,6 +307,7 @@ main (int argc, char **argv)
     }
     lseek(fdOut, 0, 0);
     Write(fdOut, (char *)&noffH, sizeof(NoffHeader));
+    WriteSymbols(fdIn, fileh.f_symptr);
     close(fdIn);
     close(fdOut);
     exit(0);
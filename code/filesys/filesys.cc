@@ -61,7 +61,9 @@
 
 // Initial file sizes for the bitmap and directory; until the file system
 // supports extensible files, the directory size sets the maximum number 
-// of files that can be loaded onto the disk.
+// of files that can be loaded onto the disk.  The bitmap's size follows
+// the disk's (nachos -disk), up to MaxFileSize; a disk formatted with
+// one size must be used with the same.
 #define FreeMapFileSize 	(NumSectors / BitsInByte)
 #define NumDirEntries 		10
 #define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
@@ -82,6 +84,7 @@
 FileSystem::FileSystem(bool format)
 { 
     DEBUG(dbgFile, "Initializing the file system.");
+    ASSERT(FreeMapFileSize <= (int) MaxFileSize);	// -disk too big for us
     if (format) {
         PersistBitMap *freeMap = new PersistBitMap(NumSectors);
         Directory *directory = new Directory(NumDirEntries);
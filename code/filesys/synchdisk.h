@@ -50,6 +50,8 @@ class SynchDisk : public CallBackObj {
 					        // with the interrupt handler
     Lock *lock;		// Only one read/write request
 					// can be sent to the disk at a time
+
+    friend class Checkpoint;	// saves and restores the disk image
 };
 
 #endif // SYNCHDISK_H
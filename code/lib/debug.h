@@ -28,6 +28,7 @@ const char dbgDisk = 'd'; 		// disk emulation (FILESYS)
 const char dbgFile = 'f'; 		// file system (FILESYS)
 const char dbgAddr = 'a'; 		// address spaces (USER_PROGRAM)
 const char dbgNet = 'n'; 		// network emulation (NETWORK)
+const char dbgState = 'x';		// user state at exit (USER_PROGRAM)
 
 const char dbgHW1 = '7'; 		// only print "[DEBUG]B11015037"
 
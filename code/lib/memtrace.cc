@@ -0,0 +1,333 @@
+// memtrace.cc
+//	Routines to encode, compress and read back memory reference
+//	traces.  See memtrace.h for the format.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "memtrace.h"
+#include <string.h>
+
+const int ThreadFlag = 4;	// bits in the first byte of a record,
+const int FrameFlag = 8;	// above the kind
+
+const int MinMatch = 4;		// shortest repeat the compression uses
+const int MaxMatch = MinMatch + 127;
+const int MaxLiterals = 128;
+const int MaxDistance = 65535;
+const int HashBits = 12;
+
+//----------------------------------------------------------------------
+// PutNumber, GetNumber
+// 	Write an unsigned number into "buffer" 7 bits to a byte, and
+//	return the # of bytes; read one back, returning 0 if it doesn't
+//	end within "size" bytes.
+//----------------------------------------------------------------------
+
+static int
+PutNumber(unsigned char *buffer, unsigned int n)
+{
+    int i = 0;
+
+    while (n >= 0x80) {
+	buffer[i++] = (n & 0x7f) | 0x80;
+	n >>= 7;
+    }
+    buffer[i++] = n;
+    return i;
+}
+
+static int
+GetNumber(unsigned char *buffer, int size, unsigned int *n)
+{
+    *n = 0;
+    for (int i = 0; i < size && i < 5; i++) {
+	*n |= (unsigned int) (buffer[i] & 0x7f) << (7 * i);
+	if ((buffer[i] & 0x80) == 0) {
+	    return i + 1;
+	}
+    }
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// MemTraceCodec::Reset
+// 	Forget the records before, at the start of a block.
+//----------------------------------------------------------------------
+
+void
+MemTraceCodec::Reset()
+{
+    thread = 0;
+    for (int i = 0; i < NumMemTraceKinds; i++) {
+	virtAddr[i] = frame[i] = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// MemTraceCodec::Encode
+// 	Write "rec" into "buffer", as a difference from the records
+//	before it.
+//----------------------------------------------------------------------
+
+int
+MemTraceCodec::Encode(MemTraceRecord *rec, unsigned char *buffer)
+{
+    int k = rec->kind;
+    unsigned int delta = (unsigned int) rec->virtAddr - virtAddr[k];
+    int n = 1;
+
+    buffer[0] = k;
+    if (rec->thread != thread) {
+	buffer[0] |= ThreadFlag;
+	n += PutNumber(buffer + n, rec->thread);
+	thread = rec->thread;
+    }
+    n += PutNumber(buffer + n, (delta << 1) ^ (unsigned int) ((int) delta >> 31));
+    virtAddr[k] = rec->virtAddr;
+    if (rec->frame != frame[k]) {
+	buffer[0] |= FrameFlag;
+	n += PutNumber(buffer + n, rec->frame);
+	frame[k] = rec->frame;
+    }
+    return n;
+}
+
+//----------------------------------------------------------------------
+// MemTraceCodec::Decode
+// 	Read the record at the start of "buffer" into "rec", undoing
+//	Encode.
+//----------------------------------------------------------------------
+
+int
+MemTraceCodec::Decode(unsigned char *buffer, int size, MemTraceRecord *rec)
+{
+    int k = buffer[0] & 3;
+    unsigned int value;
+    int n = 1, used;
+
+    if (size < 2 || k >= NumMemTraceKinds
+	|| (buffer[0] & ~(3 | ThreadFlag | FrameFlag)) != 0) {
+	return 0;
+    }
+    if (buffer[0] & ThreadFlag) {
+	if ((used = GetNumber(buffer + n, size - n, &value)) == 0) {
+	    return 0;
+	}
+	thread = value;
+	n += used;
+    }
+    if ((used = GetNumber(buffer + n, size - n, &value)) == 0) {
+	return 0;
+    }
+    virtAddr[k] += (int) ((value >> 1) ^ -(value & 1));
+    n += used;
+    if (buffer[0] & FrameFlag) {
+	if ((used = GetNumber(buffer + n, size - n, &value)) == 0) {
+	    return 0;
+	}
+	frame[k] = value;
+	n += used;
+    }
+    rec->kind = (MemTraceKind) k;
+    rec->thread = thread;
+    rec->virtAddr = virtAddr[k];
+    rec->frame = frame[k];
+    return n;
+}
+
+//----------------------------------------------------------------------
+// MemTraceCompress
+// 	Compress "size" bytes of "in" into "out", finding repeats with
+//	a hash table of where each 4 bytes were last seen.
+//----------------------------------------------------------------------
+
+static void
+PutLiterals(unsigned char *in, int count, unsigned char *out, int *n)
+{
+    while (count > 0) {
+	int chunk = min(count, MaxLiterals);
+
+	out[(*n)++] = chunk - 1;
+	memcpy(out + *n, in, chunk);
+	*n += chunk;
+	in += chunk;
+	count -= chunk;
+    }
+}
+
+int
+MemTraceCompress(unsigned char *in, int size, unsigned char *out)
+{
+    int last[1 << HashBits];
+    int i = 0, literals = 0, n = 0;
+
+    for (int h = 0; h < (1 << HashBits); h++) {
+	last[h] = -1;
+    }
+    while (i + MinMatch <= size) {
+	unsigned int word = in[i] | (in[i + 1] << 8) | (in[i + 2] << 16)
+				  | ((unsigned int) in[i + 3] << 24);
+	int h = (word * 2654435761u) >> (32 - HashBits);
+	int from = last[h];
+	int length = 0;
+
+	last[h] = i;
+	if (from >= 0 && i - from <= MaxDistance) {
+	    while (length < MaxMatch && i + length < size
+		   && in[from + length] == in[i + length]) {
+		length++;
+	    }
+	}
+	if (length < MinMatch) {
+	    i++;
+	    continue;
+	}
+	PutLiterals(in + literals, i - literals, out, &n);
+	out[n++] = 0x80 | (length - MinMatch);
+	out[n++] = (i - from) & 0xff;
+	out[n++] = (i - from) >> 8;
+	i += length;
+	literals = i;
+    }
+    PutLiterals(in + literals, size - literals, out, &n);
+    return n;
+}
+
+//----------------------------------------------------------------------
+// MemTraceDecompress
+// 	Undo MemTraceCompress, checking that "in" stays within "out".
+//----------------------------------------------------------------------
+
+int
+MemTraceDecompress(unsigned char *in, int size, unsigned char *out,
+		   int outSize)
+{
+    int i = 0, n = 0;
+
+    while (i < size) {
+	int c = in[i++];
+
+	if ((c & 0x80) == 0) {
+	    c++;
+	    if (i + c > size || n + c > outSize) {
+		return -1;
+	    }
+	    memcpy(out + n, in + i, c);
+	    i += c;
+	    n += c;
+	} else {
+	    int length = (c & 0x7f) + MinMatch;
+	    int distance;
+
+	    if (i + 2 > size) {
+		return -1;
+	    }
+	    distance = in[i] | (in[i + 1] << 8);
+	    i += 2;
+	    if (distance == 0 || distance > n || n + length > outSize) {
+		return -1;
+	    }
+	    for (int j = 0; j < length; j++, n++) {	// may overlap
+		out[n] = out[n - distance];
+	    }
+	}
+    }
+    return n;
+}
+
+//----------------------------------------------------------------------
+// MemTraceReader::MemTraceReader
+// 	Open a trace, and check that it is one.
+//----------------------------------------------------------------------
+
+MemTraceReader::MemTraceReader(const char *fileName)
+{
+    char magic[4];
+
+    raw = new unsigned char[MemTraceBlockSize];
+    packed = new unsigned char[MemTraceMaxPacked];
+    rawSize = position = 0;
+    file = fopen(fileName, "rb");
+    if (file != NULL && (fread(magic, 1, 4, file) != 4
+			 || memcmp(magic, MemTraceMagic, 4) != 0)) {
+	fclose(file);
+	file = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// MemTraceReader::~MemTraceReader
+//----------------------------------------------------------------------
+
+MemTraceReader::~MemTraceReader()
+{
+    if (file != NULL) {
+	fclose(file);
+    }
+    delete [] raw;
+    delete [] packed;
+}
+
+//----------------------------------------------------------------------
+// MemTraceReader::ReadBlock
+// 	Read the next block into "raw".  FALSE at the end of the file,
+//	or if the block is bad.
+//----------------------------------------------------------------------
+
+bool
+MemTraceReader::ReadBlock()
+{
+    unsigned char sizes[8];
+    int packedSize;
+
+    if (file == NULL || fread(sizes, 1, 8, file) != 8) {
+	return FALSE;
+    }
+    rawSize = sizes[0] | (sizes[1] << 8) | (sizes[2] << 16) | (sizes[3] << 24);
+    packedSize = sizes[4] | (sizes[5] << 8) | (sizes[6] << 16) | (sizes[7] << 24);
+    if (rawSize <= 0 || rawSize > MemTraceBlockSize || packedSize <= 0
+	|| packedSize > MemTraceMaxPacked) {
+	return FALSE;
+    }
+    if (packedSize == rawSize) {		// stored as it is
+	if ((int) fread(raw, 1, rawSize, file) != rawSize) {
+	    return FALSE;
+	}
+    } else if ((int) fread(packed, 1, packedSize, file) != packedSize
+	       || MemTraceDecompress(packed, packedSize, raw,
+				     MemTraceBlockSize) != rawSize) {
+	return FALSE;
+    }
+    position = 0;
+    codec.Reset();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// MemTraceReader::Next
+// 	Return the next record of the trace in "rec".
+//----------------------------------------------------------------------
+
+bool
+MemTraceReader::Next(MemTraceRecord *rec)
+{
+    int n;
+
+    if (position == rawSize && !ReadBlock()) {
+	return FALSE;
+    }
+    n = codec.Decode(raw + position, rawSize - position, rec);
+    if (n == 0) {
+	position = rawSize = 0;		// give up on the rest
+	if (file != NULL) {
+	    fclose(file);
+	    file = NULL;
+	}
+	return FALSE;
+    }
+    position += n;
+    return TRUE;
+}
@@ -0,0 +1,127 @@
+// memtrace.h
+//	The format of memory reference traces (nachos -memtrace), and a
+//	library to read them back.
+//
+//	A trace lists every instruction fetch, load and store of the user
+//	programs, in the order they happened: which thread made it, the
+//	virtual address, and the physical page it went to.  A program
+//	that wants to try a cache or a paging policy on the same
+//	references can read the trace with a MemTraceReader instead of
+//	running Nachos again.  This file and memtrace.cc only use the C
+//	library, so they can be compiled into such a program as they are.
+//
+//	The file is the 4 bytes of MemTraceMagic, then blocks.  A block
+//	is its size before and after compression, 4 bytes each, little
+//	endian, then the compressed bytes (or, if compressing didn't make
+//	them any smaller, the bytes as they are: then the two sizes are
+//	the same).  Uncompressed, a block holds at most MemTraceBlockSize
+//	bytes of records, one after another.
+//
+//	A record is a byte holding its kind, and flags for whether the
+//	thread is different from the last record's, and whether the page
+//	is different from the last record of the same kind's; then the
+//	new thread, if it changed; then how far the address is from the
+//	one in the last record of that kind; then the new page, if it
+//	changed.  Numbers are 7 bits to a byte, low bits first, with the
+//	top bit set in all but the last byte; the address difference is
+//	signed, and is doubled, with the sign in the low bit.  Fetches are
+//	mostly 4 bytes apart, and most records are 2 bytes long.
+//
+//	Each block starts from scratch, as if the thread, addresses and
+//	pages before it were all 0.  The compression is a simple LZ77:
+//	a byte with the top bit clear is followed by 1 + its value bytes
+//	to copy; one with the top bit set says to repeat 4 + its low 7
+//	bits bytes, from as far back as the following 2 bytes say.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef MEMTRACE_H
+#define MEMTRACE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include <stdio.h>
+
+const char MemTraceMagic[] = "NMT1";	// first 4 bytes of a trace
+const int MemTraceBlockSize = 64 * 1024;// most bytes of records in a block
+const int MemTraceMaxRecord = 16;	// most bytes in one record
+const int MemTraceMaxPacked = MemTraceBlockSize + MemTraceBlockSize / 128 + 16;
+					// most bytes a block compresses to
+
+// The kinds of references
+
+enum MemTraceKind { TraceFetch, TraceLoad, TraceStore };
+
+const int NumMemTraceKinds = 3;
+
+// One reference
+
+class MemTraceRecord {
+  public:
+    MemTraceKind kind;		// store is the only write
+    int thread;			// the thread that made it (Thread::getId)
+    int virtAddr;		// the address the program used
+    int frame;			// the physical page it went to
+};
+
+// The state records are encoded against: the last thread, and what
+// each kind of record last had.
+
+class MemTraceCodec {
+  public:
+    MemTraceCodec() { Reset(); }
+
+    void Reset();		// Start a block
+    int Encode(MemTraceRecord *rec, unsigned char *buffer);
+				// Encode "rec" into "buffer"; return the
+				// # of bytes (at most MemTraceMaxRecord)
+    int Decode(unsigned char *buffer, int size, MemTraceRecord *rec);
+				// Decode the record at the start of the
+				// "size" bytes in "buffer" into "rec";
+				// return its # of bytes, 0 if it's bad
+
+  private:
+    int thread;
+    int virtAddr[NumMemTraceKinds];
+    int frame[NumMemTraceKinds];
+};
+
+extern int MemTraceCompress(unsigned char *in, int size, unsigned char *out);
+				// Compress "size" bytes into "out", which
+				// has room for MemTraceMaxPacked; return
+				// how many it took
+extern int MemTraceDecompress(unsigned char *in, int size,
+			      unsigned char *out, int outSize);
+				// Undo MemTraceCompress; return the # of
+				// bytes, or -1 if "in" is bad
+
+// The following class reads the records of a trace, in order.
+
+class MemTraceReader {
+  public:
+    MemTraceReader(const char *fileName);
+				// Open the trace in "fileName"
+    ~MemTraceReader();
+
+    bool IsOpen() { return file != NULL; }
+				// FALSE if the file isn't there, or isn't
+				// a trace
+    bool Next(MemTraceRecord *rec);
+				// Read the next record into "rec"; FALSE
+				// at the end of the trace (or if the rest
+				// of it is bad)
+
+  private:
+    bool ReadBlock();		// Read and uncompress the next block
+
+    FILE *file;
+    unsigned char *raw;		// the records of the block being read
+    unsigned char *packed;	// the block as it was in the file
+    int rawSize;		// # of bytes in "raw"
+    int position;		// where the next record starts in "raw"
+    MemTraceCodec codec;
+};
+
+#endif // MEMTRACE_H
@@ -44,9 +44,7 @@ extern "C" {
 #include <signal.h>
 #include <sys/types.h>
 
-#ifndef NO_MPROT 
 #include <sys/mman.h>
-#endif
 
 // UNIX routines called by procedures in this file 
 
@@ -355,6 +353,39 @@ Unlink(char *name)
     return unlink(name);
 }
 
+//----------------------------------------------------------------------
+// MapFile
+// 	Map a whole file into memory, read-only, and return where it is
+//	and, in "size", how long it is.  NULL if it can't be opened.
+//----------------------------------------------------------------------
+
+char *
+MapFile(char *name, int *size)
+{
+    int fd = open(name, O_RDONLY, 0);
+    void *data;
+
+    if (fd < 0) {
+	return NULL;
+    }
+    *size = lseek(fd, 0, SEEK_END);
+    data = mmap(NULL, *size > 0 ? *size : 1, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);				// the mapping stays
+    ASSERT(data != MAP_FAILED);
+    return (char *) data;
+}
+
+//----------------------------------------------------------------------
+// UnmapFile
+// 	Undo MapFile.
+//----------------------------------------------------------------------
+
+void
+UnmapFile(char *data, int size)
+{
+    munmap(data, size > 0 ? size : 1);
+}
+
 #ifdef NETWORK
 //----------------------------------------------------------------------
 // OpenSocket
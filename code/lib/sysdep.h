@@ -50,6 +50,8 @@ extern void Lseek(int fd, int offset, int whence);
 extern int Tell(int fd);
 extern void Close(int fd);
 extern bool Unlink(char *name);
+extern char *MapFile(char *name, int *size);
+extern void UnmapFile(char *data, int size);
 
 // Other C library routines that are used by Nachos.
 // These are assumed to be portable, so we don't include a wrapper.
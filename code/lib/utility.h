@@ -35,4 +35,10 @@
 typedef void (*VoidFunctionPtr)(void *arg); 
 typedef void (*VoidNoArgFunctionPtr)(); 
 
+// Simulated time, in ticks (see stats.h), and the counts kept of
+// what happens in it.  64 bits, so that a long simulation doesn't run
+// the clock past 2^31 and wrap around.
+
+typedef long long Ticks;
+
 #endif //UTILITY_H
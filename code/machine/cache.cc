@@ -0,0 +1,117 @@
+// cache.cc
+//	Routines to emulate a set-associative cache.  See cache.h.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "cache.h"
+#include "debug.h"
+#include "sysdep.h"
+
+//----------------------------------------------------------------------
+// Cache::Cache
+// 	Initialize an empty cache.
+//
+//	"sets" -- the number of sets
+//	"ways" -- the associativity: the number of lines in a set
+//	"lineBytes" -- the size of a line; a power of 2, at least a word
+//	"policy" -- which line of a set a miss replaces
+//	"hit", "miss" -- the time, in ticks, of a hit and of a miss
+//	"counts" -- where to count hits, misses and write-backs
+//----------------------------------------------------------------------
+
+Cache::Cache(int sets, int ways, int lineBytes, ReplacementPolicy policy,
+	     int hit, int miss, CacheStatistics *counts)
+{
+    ASSERT(sets > 0 && ways > 0);
+    ASSERT(lineBytes >= 4 && (lineBytes & (lineBytes - 1)) == 0);
+    numSets = sets;
+    assoc = ways;
+    lineSize = lineBytes;
+    replace = policy;
+    hitTime = hit;
+    missTime = miss;
+    stats = counts;
+    now = 0;
+    lines = new CacheLine[numSets * assoc];
+    for (int i = 0; i < numSets * assoc; i++) {
+	lines[i].valid = FALSE;
+	lines[i].dirty = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// Cache::~Cache
+//----------------------------------------------------------------------
+
+Cache::~Cache()
+{
+    delete [] lines;
+}
+
+//----------------------------------------------------------------------
+// Cache::Access
+// 	Simulate a read ("writing" FALSE) or write of the physical
+//	address "physAddr".  Return the number of ticks it took: the hit
+//	time, or else the miss time, plus the miss time again if we
+//	had to write back the dirty line it replaced.
+//----------------------------------------------------------------------
+
+int
+Cache::Access(int physAddr, bool writing)
+{
+    int tag = (unsigned) physAddr / lineSize;
+    CacheLine *set = &lines[(tag % numSets) * assoc];
+    CacheLine *victim;
+    int ticks;
+
+    now++;
+    for (int i = 0; i < assoc; i++) {
+	if (set[i].valid && set[i].tag == tag) {
+	    if (replace == LRUReplace) {
+		set[i].lastUse = now;
+	    }
+	    set[i].dirty |= writing;
+	    stats->hits++;
+	    stats->stallTicks += hitTime;
+	    return hitTime;
+	}
+    }
+
+    // a miss: use an empty line, or replace one
+    victim = NULL;
+    for (int i = 0; i < assoc && victim == NULL; i++) {
+	if (!set[i].valid) {
+	    victim = &set[i];
+	}
+    }
+    if (victim == NULL) {
+	if (replace == RandomReplace) {
+	    victim = &set[RandomNumber() % assoc];
+	} else {		// the oldest, by use or by arrival
+	    victim = &set[0];
+	    for (int i = 1; i < assoc; i++) {
+		if (set[i].lastUse < victim->lastUse) {
+		    victim = &set[i];
+		}
+	    }
+	}
+    }
+    ticks = missTime;
+    if (victim->valid && victim->dirty) {
+	stats->writebacks++;
+	ticks += missTime;
+    }
+    DEBUG(dbgMach, "Cache miss at 0x" << std::hex << physAddr << std::dec);
+    victim->valid = TRUE;
+    victim->dirty = writing;
+    victim->tag = tag;
+    victim->lastUse = now;
+    stats->misses++;
+    stats->stallTicks += ticks;
+    return ticks;
+}
@@ -0,0 +1,86 @@
+// cache.h
+//	Data structures to emulate a set-associative cache, between the
+//	simulated CPU and main memory.
+//
+//	The simulator can put one in front of instruction fetches (the
+//	I-cache) and one in front of loads and stores (the D-cache); see
+//	nachos -icache and -dcache.  A cache only keeps track of which
+//	lines of physical memory it holds: the data itself is always read
+//	from, and written to, mainMemory.  What it changes is how long
+//	the program takes -- each access costs the hit or the miss time,
+//	added to the instruction's tick -- and the statistics.
+//
+//	Loads and stores are write-back and write-allocate: a store that
+//	misses brings the line in, and a line that was stored to costs
+//	another miss time when it is thrown out.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "stats.h"
+
+// Which line of a set to throw out on a miss
+
+enum ReplacementPolicy { LRUReplace,		// least recently used
+			 FIFOReplace,		// first one brought in
+			 RandomReplace		// any (see RandomNumber)
+};
+
+// The shape of a cache, as given on the command line
+
+class CacheGeometry {
+  public:
+    int sets;			// # of sets; 0 if there is no cache
+    int ways;			// # of lines per set
+    int lineSize;		// in bytes
+    ReplacementPolicy policy;
+};
+
+// One line of the cache
+
+class CacheLine {
+  public:
+    bool valid;
+    bool dirty;			// stored to since it was brought in
+    int tag;			// physical address / lineSize
+    unsigned long long lastUse;	// when it was last used (for LRU) or
+				// brought in (for FIFO)
+};
+
+// The following class defines a cache.
+
+class Cache {
+  public:
+    Cache(int sets, int ways, int lineBytes, ReplacementPolicy policy,
+	  int hit, int miss, CacheStatistics *counts);
+				// Initialize an empty cache of "sets" sets
+				// of "ways" lines of "lineBytes" bytes each;
+				// count hits and misses in "counts"
+    ~Cache();
+
+    int Access(int physAddr, bool writing);
+				// Look up "physAddr", bringing its line in
+				// if need be; return how many ticks that
+				// took
+
+  private:
+    int numSets;
+    int assoc;			// # of lines per set
+    int lineSize;		// in bytes
+    ReplacementPolicy replace;
+    int hitTime;		// ticks for a hit
+    int missTime;		//   for a miss, and for a write-back
+    CacheLine *lines;		// numSets * assoc of them, a set at a time
+    unsigned long long now;	// # of accesses so far
+    CacheStatistics *stats;
+};
+
+#endif // CACHE_H
@@ -59,20 +59,36 @@ ConsoleInput::~ConsoleInput()
 //
 //	First check to make sure character is available.
 //	Then invoke the "callBack" registered by whoever wants the character.
+//
+//	When replaying (nachos -replay), the characters come from the
+//	log instead, at the times they were typed, and we don't look
+//	at the host at all.
 //----------------------------------------------------------------------
 
 void
 ConsoleInput::CallBack()
 {
     char c;
+    EventLog *log = kernel->eventLog;
+    bool avail;
 
     ASSERT(incoming == EOF);
-    if (!PollFile(readFileNo)) { // nothing to be read
+    if (log != NULL && log->Replaying()) {
+	avail = log->Replay(ConsoleEvent, &c, sizeof(char));
+    } else {
+	avail = PollFile(readFileNo);
+	if (avail) {
+	    Read(readFileNo, &c, sizeof(char));
+	    if (log != NULL) {
+		log->Record(ConsoleEvent, &c, sizeof(char));
+	    }
+	}
+    }
+    if (!avail) { // nothing to be read
         // schedule the next time to poll for a packet
         kernel->interrupt->Schedule(this, ConsoleTime, ConsoleReadInt);
     } else { 
-    	// otherwise, read character and tell user about it
-    	Read(readFileNo, &c, sizeof(char));
+    	// otherwise, tell user about the character
     	incoming = c;
     	kernel->stats->numConsoleCharsRead++;
     	callWhenAvail->CallBack();
@@ -22,16 +22,36 @@
 // disk, to make it less likely we will accidentally treat a useful file 
 // as a disk (which would probably trash the file's contents).
 
-const int MagicNumber = 0x456789ab;
-const int MagicSize = sizeof(int);
-const int DiskSize = (MagicSize + (NumSectors * SectorSize));
 
+int SectorsPerTrack = DefaultSectorsPerTrack;
+int NumTracks = DefaultNumTracks;
+int NumSectors = DefaultSectorsPerTrack * DefaultNumTracks;
+
+//----------------------------------------------------------------------
+// SetDiskGeometry
+// 	Make every disk "tracks" tracks of "sectorsPerTrack" sectors,
+//	instead of the defaults (nachos -disk).  The swap space, and the
+//	free sector map of the file system, are sized from this, so it
+//	must come before the Machine or any disk is made.  The free map
+//	is kept a whole number of words.
+//----------------------------------------------------------------------
+
+void
+SetDiskGeometry(int tracks, int sectorsPerTrack)
+{
+    ASSERT(tracks > 0 && sectorsPerTrack > 0);
+    ASSERT((tracks * sectorsPerTrack) % (sizeof(unsigned int) * 8) == 0);
+    NumTracks = tracks;
+    SectorsPerTrack = sectorsPerTrack;
+    NumSectors = tracks * sectorsPerTrack;
+}
 
 //----------------------------------------------------------------------
 // Disk::Disk()
 // 	Initialize a simulated disk.  Open the UNIX file (creating it
 //	if it doesn't exist), and check the magic number to make sure it's 
-// 	ok to treat it as Nachos disk storage.
+// 	ok to treat it as Nachos disk storage.  If it is smaller than
+//	NumSectors (it was made with a smaller -disk), make it bigger.
 //
 //	"name" -- text name of the file simulating the Nachos disk
 //	"toCall" -- object to call when disk read/write request completes
@@ -41,6 +61,7 @@ Disk::Disk(char* name, CallBackObj *toCall)
 {
     int magicNum;
     int tmp = 0;
+    int diskSize = MagicSize + NumSectors * SectorSize;
 
     DEBUG(dbgDisk, "Initializing the disk.");
     callWhenDone = toCall;
@@ -51,13 +72,18 @@ Disk::Disk(char* name, CallBackObj *toCall)
     if (fileno >= 0) {		 	// file exists, check magic number 
         Read(fileno, (char *) &magicNum, MagicSize);
         ASSERT(magicNum == MagicNumber);
+        Lseek(fileno, 0, 2);
+        if (Tell(fileno) < diskSize) {
+            Lseek(fileno, diskSize - sizeof(int), 0);
+            WriteFile(fileno, (char *)&tmp, sizeof(int));
+        }
     } else {				// file doesn't exist, create it
         fileno = OpenForWrite(name);
         magicNum = MagicNumber;  
         WriteFile(fileno, (char *) &magicNum, MagicSize); // write magic number
 
     	// need to write at end of file, so that reads will not return EOF
-        Lseek(fileno, DiskSize - sizeof(int), 0);	
+        Lseek(fileno, diskSize - sizeof(int), 0);	
 	    WriteFile(fileno, (char *)&tmp, sizeof(int));  
     }
     active = FALSE;
@@ -196,7 +222,7 @@ Disk::TimeToSeek(int newSector, int *rotation)
 //----------------------------------------------------------------------
 
 int 
-Disk::ModuloDiff(int to, int from)
+Disk::ModuloDiff(int to, Ticks from)
 {
     int toOffset = to % SectorsPerTrack;
     int fromOffset = from % SectorsPerTrack;
@@ -228,7 +254,7 @@ Disk::ModuloDiff(int to, int from)
 int Disk::ComputeLatency(int newSector, bool writing) {
     int rotation;
     int seek = TimeToSeek(newSector, &rotation);
-    int timeAfter = kernel->stats->totalTicks + seek + rotation;
+    Ticks timeAfter = kernel->stats->totalTicks + seek + rotation;
 
 #ifndef NOTRACKBUF	// turn this on if you don't want the track buffer stuff
     // check if track buffer applies
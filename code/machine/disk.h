@@ -48,10 +48,16 @@
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
 
 const int SectorSize = 128;		// number of bytes per disk sector
-const int SectorsPerTrack  = 32;	// number of sectors per disk track 
-const int NumTracks = 32;		// number of tracks per disk
-const int NumSectors = (SectorsPerTrack * NumTracks);
-					// total # of sectors per disk
+const int DefaultSectorsPerTrack = 32;	// unless nachos -disk says otherwise
+const int DefaultNumTracks = 32;
+extern int SectorsPerTrack;		// number of sectors per disk track 
+extern int NumTracks;			// number of tracks per disk
+extern int NumSectors;			// total # of sectors per disk
+extern void SetDiskGeometry(int tracks, int sectorsPerTrack);
+					// Set all three, before any Disk, or
+					// the Machine, is made
+const int MagicNumber = 0x456789ab;	// at the start of the UNIX file,
+const int MagicSize = sizeof(int);	// before the sectors
 
 class Disk : public CallBackObj {
   public:
@@ -80,12 +86,15 @@ class Disk : public CallBackObj {
     CallBackObj *callWhenDone;		// Invoke when any disk request finishes
     bool active;     			// Is a disk operation in progress?
     int lastSector;			// The previous disk request 
-    int bufferInit;			// When the track buffer started 
+    Ticks bufferInit;			// When the track buffer started 
 					// being loaded
 
     int TimeToSeek(int newSector, int *rotate); // time to get to the new track
-    int ModuloDiff(int to, int from);        // # sectors between to and from
+    int ModuloDiff(int to, Ticks from);      // # sectors between to and from
     void UpdateLast(int newSector);
+
+    friend class Checkpoint;	// saves and restores the sectors and
+				// where the head is
 };
 
 #endif // DISK_H
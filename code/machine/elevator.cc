@@ -95,7 +95,7 @@ class ElevatorInfo {
     bool doorsOpen;		// are the doors open?
     bool inMotion;		// is the elevator moving?
     int lastFloor;		// last floor the elevator was on
-    int willArrive;		// when will it arrive at the next floor?
+    Ticks willArrive;		// when will it arrive at the next floor?
     int goingTo;		// where is the elevator going (if anywhere)
     List<Thread *> *riders;	// who is on board?
 };
@@ -0,0 +1,182 @@
+// eventlog.cc
+//	Routines to record the events that come into the simulation from
+//	outside, and to replay them.  See eventlog.h.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "eventlog.h"
+#include "main.h"
+#include "sysdep.h"
+
+//----------------------------------------------------------------------
+// EventLog::EventLog
+// 	Create the log "fileName" and write its magic number, or, if
+//	"replay", map it in and sort its events by kind.
+//----------------------------------------------------------------------
+
+EventLog::EventLog(char *fileName, bool replay)
+{
+    LoggedEvent *event;
+    int position;
+    unsigned char kind;
+    unsigned short size;
+
+    replaying = replay;
+    fd = -1;
+    buffer = NULL;
+    used = 0;
+    log = NULL;
+    logSize = 0;
+    for (int i = 0; i < NumEventKinds; i++) {
+	pending[i] = new List<LoggedEvent *>;
+    }
+
+    if (!replaying) {
+	fd = OpenForWrite(fileName);
+	WriteFile(fd, (char *) EventLogMagic, 4);
+	buffer = new char[EventLogBufferSize];
+	return;
+    }
+
+    log = MapFile(fileName, &logSize);
+    if (log == NULL || logSize < 4 || memcmp(log, EventLogMagic, 4) != 0) {
+	cerr << "Can't replay " << fileName << ": not an event log\n";
+	Abort();
+    }
+    for (position = 4; position < logSize; position += size) {
+	ASSERT(position + EventHeaderSize <= logSize);
+	event = new LoggedEvent;
+	bcopy(log + position, &event->when, 8);
+	kind = log[position + 8];
+	bcopy(log + position + 9, &size, 2);
+	position += EventHeaderSize;
+	ASSERT(kind < NumEventKinds && position + size <= logSize);
+	event->data = log + position;
+	event->size = size;
+	pending[kind]->Append(event);
+    }
+}
+
+//----------------------------------------------------------------------
+// EventLog::~EventLog
+// 	Write out the rest of the log being recorded, or unmap the one
+//	being replayed.
+//----------------------------------------------------------------------
+
+EventLog::~EventLog()
+{
+    if (replaying) {
+	for (int i = 0; i < NumEventKinds; i++) {
+	    while (!pending[i]->IsEmpty()) {
+		delete pending[i]->RemoveFront();
+	    }
+	}
+	UnmapFile(log, logSize);
+    } else {
+	Flush();
+	Close(fd);
+	delete [] buffer;
+    }
+    for (int i = 0; i < NumEventKinds; i++) {
+	delete pending[i];
+    }
+}
+
+//----------------------------------------------------------------------
+// EventLog::Flush
+// 	Write out what has been recorded so far.
+//----------------------------------------------------------------------
+
+void
+EventLog::Flush()
+{
+    if (used > 0) {
+	WriteFile(fd, buffer, used);
+	used = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// EventLog::Record
+// 	Log an event that has just come in from outside, at the current
+//	time.  Characters typed at the console are written out at once,
+//	so nothing typed is lost if nachos is killed; the rest is
+//	written when the buffer fills.
+//
+//	"kind" -- what it was
+//	"data", "size" -- what it brought in
+//----------------------------------------------------------------------
+
+void
+EventLog::Record(EventKind kind, void *data, int size)
+{
+    Ticks when = kernel->stats->totalTicks;
+    unsigned char k = kind;
+    unsigned short s = size;
+
+    ASSERT(!replaying && size >= 0 && size <= 0xffff);
+    if (used + EventHeaderSize + size > EventLogBufferSize) {
+	Flush();
+    }
+    if (EventHeaderSize + size > EventLogBufferSize) {	// too big to buffer
+	char header[EventHeaderSize];
+
+	bcopy(&when, header, 8);
+	header[8] = k;
+	bcopy(&s, header + 9, 2);
+	WriteFile(fd, header, EventHeaderSize);
+	WriteFile(fd, (char *) data, size);
+	return;
+    }
+    bcopy(&when, buffer + used, 8);
+    buffer[used + 8] = k;
+    bcopy(&s, buffer + used + 9, 2);
+    bcopy(data, buffer + used + EventHeaderSize, size);
+    used += EventHeaderSize + size;
+    if (kind == ConsoleEvent) {
+	Flush();
+    }
+}
+
+//----------------------------------------------------------------------
+// EventLog::Replay
+// 	Called by a device where it would have asked the host for an
+//	event: if the next one of this kind in the log is due, copy it
+//	out and return TRUE; otherwise, nothing has come in.
+//
+//	An event that is overdue means this run is not the same as the
+//	one recorded (a different program, or a different nachos); we
+//	still hand it over, but say so.
+//
+//	"kind" -- what the device wants
+//	"data", "size" -- where to put it, and how much room there is
+//----------------------------------------------------------------------
+
+bool
+EventLog::Replay(EventKind kind, void *data, int size)
+{
+    LoggedEvent *event;
+
+    ASSERT(replaying);
+    if (pending[kind]->IsEmpty()) {
+	return FALSE;
+    }
+    event = pending[kind]->Front();
+    if (event->when > kernel->stats->totalTicks) {
+	return FALSE;
+    }
+    if (event->when < kernel->stats->totalTicks) {
+	DEBUG(dbgInt, "Replay out of step: event of kind " << kind
+	      << " logged at " << event->when << ", now "
+	      << kernel->stats->totalTicks);
+    }
+    ASSERT(event->size <= size);
+    bcopy(event->data, data, event->size);
+    delete pending[kind]->RemoveFront();
+    return TRUE;
+}
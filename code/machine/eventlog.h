@@ -0,0 +1,90 @@
+// eventlog.h
+//	Data structures to record the events that come into the simulation
+//	from outside it, and to replay them (nachos -record and -replay).
+//
+//	Nachos is deterministic except for what it gets from the host:
+//	the characters typed at the console, the packets that arrive
+//	from other nachos, and the random time slices of -rs.  When
+//	recording, each of these is logged with the simulated time it
+//	came in; when replaying, the devices take them from the log at
+//	the same times instead of asking the host, so the run is the
+//	same as the one recorded, tick for tick.
+//
+//	The random seed is logged too, at the start, and the replay
+//	starts from it: the caches, the TLB and the network draw random
+//	numbers as well, and must draw the same ones as the run recorded.
+//
+//	The log is a 4 byte magic number, then one record per event:
+//	the time (8 bytes), the kind (1 byte), the size of the data
+//	(2 bytes) and the data, all in the host's byte order.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "list.h"
+
+#define EventLogMagic "NEV2"
+
+const int EventHeaderSize = 11;		// the time, kind and size
+
+const int EventLogBufferSize = 4096;	// how much to record before
+					// writing it out
+
+// The kinds of event from outside the simulation
+
+enum EventKind { ConsoleEvent,		// a character read from the console
+		 PacketEvent,		// a packet read from the network
+		 TimerEvent,		// a random time slice (-rs)
+		 SeedEvent,		// the random seed, at the start
+		 NumEventKinds };
+
+// An event in the log being replayed
+
+class LoggedEvent {
+  public:
+    Ticks when;			// the time it came in
+    char *data;			// what came in, in the mapped log
+    int size;			//   and how many bytes
+};
+
+// The following class defines a log of events, being recorded or
+// replayed.
+
+class EventLog {
+  public:
+    EventLog(char *fileName, bool replay);
+				// Create the log "fileName" to record
+				// in, or read it in to replay
+    ~EventLog();		// Write out what's left, and close it
+
+    bool Replaying() { return replaying; }
+
+    void Record(EventKind kind, void *data, int size);
+				// Log an event that just came in
+    bool Replay(EventKind kind, void *data, int size);
+				// If an event of this kind was recorded
+				// now (or before), copy it into "data"
+				// and return TRUE
+
+  private:
+    void Flush();		// Write out what has been recorded
+
+    bool replaying;		// TRUE if replaying, FALSE if recording
+    int fd;			// when recording, the log file,
+    char *buffer;		//   what has not been written to it yet,
+    int used;			//   and how much of it there is
+    char *log;			// when replaying, the log, mapped in,
+    int logSize;		//   its size,
+    List<LoggedEvent *> *pending[NumEventKinds];
+				//   and the events not yet replayed
+};
+
+#endif // EVENTLOG_H
@@ -23,13 +23,14 @@
 #include "copyright.h"
 #include "interrupt.h"
 #include "main.h"
+#include <algorithm>
 
 // String definitions for debugging messages
 
 static char *intLevelNames[] = { "off", "on"};
 static char *intTypeNames[] = { "timer", "disk", "console write", 
 			"console read", "elevator", "network send", 
-			"network recv"};
+			"network recv", "alarm"};
 
 //----------------------------------------------------------------------
 // PendingInterrupt::PendingInterrupt
@@ -42,26 +43,17 @@ static char *intTypeNames[] = { "timer", "disk", "console write",
 //----------------------------------------------------------------------
 
 PendingInterrupt::PendingInterrupt(CallBackObj *callOnInt, 
-					int time, IntType kind)
+					Ticks time, IntType kind)
 {
     callOnInterrupt = callOnInt;
     when = time;
     type = kind;
+    order = 0;
+    heapIndex = -1;
+    generation = 0;
 }
 
 //----------------------------------------------------------------------
-// PendingCompare
-//	Compare to interrupts based on which should occur first.
-//----------------------------------------------------------------------
-
-static int
-PendingCompare (PendingInterrupt *x, PendingInterrupt *y)
-{
-    if (x->when < y->when) { return -1; }
-    else if (x->when > y->when) { return 1; }
-    else { return 0; }
-}
-
 //----------------------------------------------------------------------
 // Interrupt::Interrupt
 // 	Initialize the simulation of hardware device interrupts.
@@ -72,7 +64,7 @@ PendingCompare (PendingInterrupt *x, PendingInterrupt *y)
 Interrupt::Interrupt()
 {
     level = IntOff;
-    pending = new SortedList<PendingInterrupt *>(PendingCompare);
+    scheduled = 0;
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -84,10 +76,6 @@ Interrupt::Interrupt()
 //----------------------------------------------------------------------
 
 Interrupt::~Interrupt() {
-    while (!pending->IsEmpty()) {
-	    delete pending->RemoveFront();
-    }
-    delete pending;
 }
 
 //----------------------------------------------------------------------
@@ -140,6 +128,9 @@ Interrupt::SetLevel(IntStatus now) {
 //	Two things can cause OneTick to be called:
 //		interrupts are re-enabled
 //		a user instruction is executed
+//
+//	With more than one processor, the latter is also where the
+//	processors take turns (see Scheduler::CpuTick).
 //----------------------------------------------------------------------
 void
 Interrupt::OneTick() {
@@ -151,7 +142,9 @@ Interrupt::OneTick() {
         stats->totalTicks += SystemTick;
 	    stats->systemTicks += SystemTick;
     } else {					// USER_PROGRAM
-        stats->totalTicks += UserTick;
+        if (kernel->scheduler->OnClockCpu()) {	// see Scheduler::OnClockCpu
+            stats->totalTicks += UserTick;
+        }
         stats->userTicks += UserTick;
     }
     DEBUG(dbgInt, "== Tick " << stats->totalTicks << " ==");
@@ -166,9 +159,18 @@ Interrupt::OneTick() {
     				// for a context switch, ok to do it now
         yieldOnReturn = FALSE;
         status = SystemMode;		// yield is a kernel routine
+        kernel->currentThread->setUserPreempted(oldStatus == UserMode);
         kernel->currentThread->Yield();
+        kernel->currentThread->setUserPreempted(FALSE);
         status = oldStatus;
     }
+    if (oldStatus == UserMode && kernel->scheduler->NumCpus() > 1) {
+        ChangeLevel(IntOn, IntOff);	// a user instruction is done; 
+        status = SystemMode;		// maybe let another processor
+        kernel->scheduler->CpuTick();	// have a turn
+        status = oldStatus;
+        ChangeLevel(IntOff, IntOn);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -234,9 +236,15 @@ Interrupt::Halt() {
 //----------------------------------------------------------------------
 // Interrupt::Schedule
 // 	Arrange for the CPU to be interrupted when simulated time
-//	reaches "now + when".
+//	reaches "now + when".  Return a handle on the interrupt, to
+//	Cancel or Reschedule it.
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: take a record from the pool (they are reused
+//	rather than allocated one by one) and push it on a heap ordered
+//	by when it is due, and then by when it was scheduled.  Each
+//	record knows where it is in the heap, so that one can be taken
+//	out of the middle, or moved, as easily as from the front: all in
+//	time logarithmic in the number pending.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -246,15 +254,191 @@ Interrupt::Halt() {
 //		 interrupt is to occur
 //	"type" is the hardware device that generated the interrupt
 //----------------------------------------------------------------------
-void
+InterruptHandle
 Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type) {
-    int when = kernel->stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(toCall, when, type);
+    Ticks when = kernel->stats->totalTicks + fromNow;
+    InterruptHandle handle;
+    PendingInterrupt *toOccur;
 
     DEBUG(dbgInt, "Scheduling interrupt handler the " << intTypeNames[type] << " at time = " << when);
     ASSERT(fromNow > 0);
 
-    pending->Insert(toOccur);
+    if (freeRecords.empty()) {
+	records.push_back(PendingInterrupt(NULL, 0, TimerInt));
+	freeRecords.push_back(records.size() - 1);
+    }
+    handle.record = freeRecords.back();
+    freeRecords.pop_back();
+    toOccur = &records[handle.record];
+    toOccur->callOnInterrupt = toCall;
+    toOccur->when = when;
+    toOccur->type = type;
+    toOccur->order = scheduled++;
+    handle.generation = toOccur->generation;
+
+    heap.push_back(handle.record);
+    Place(heap.size() - 1, handle.record);
+    SiftUp(heap.size() - 1);
+    return handle;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Cancel
+// 	Take a scheduled interrupt back.  Return FALSE if it has already
+//	fired, or been cancelled.
+//
+//	"handle" is what Schedule returned
+//----------------------------------------------------------------------
+
+bool
+Interrupt::Cancel(InterruptHandle handle) {
+    int record = FindRecord(handle);
+
+    if (record == -1) {
+	return FALSE;
+    }
+    DEBUG(dbgInt, "Cancelling interrupt handler the " << intTypeNames[records[record].type] << " at time = " << records[record].when);
+    Remove(records[record].heapIndex);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Reschedule
+// 	Make a scheduled interrupt fire "fromNow" ticks from now,
+//	instead of when it was due.  Among those due at the same time,
+//	it fires as if it had just been scheduled.  Return FALSE if it
+//	has already fired, or been cancelled: then the caller must
+//	Schedule it again.
+//
+//	"handle" is what Schedule returned
+//----------------------------------------------------------------------
+
+bool
+Interrupt::Reschedule(InterruptHandle handle, int fromNow) {
+    int record = FindRecord(handle);
+
+    ASSERT(fromNow > 0);
+    if (record == -1) {
+	return FALSE;
+    }
+    records[record].when = kernel->stats->totalTicks + fromNow;
+    records[record].order = scheduled++;
+    DEBUG(dbgInt, "Rescheduling interrupt handler the " << intTypeNames[records[record].type] << " at time = " << records[record].when);
+    SiftUp(records[record].heapIndex);
+    SiftDown(records[record].heapIndex);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::FindRecord
+// 	Return the record of the interrupt "handle" was returned for, or
+//	-1 if the handle is stale: it has fired, or been cancelled.
+//----------------------------------------------------------------------
+
+int
+Interrupt::FindRecord(InterruptHandle handle) {
+    if (handle.record < 0 || handle.record >= (int) records.size()
+	|| records[handle.record].generation != handle.generation
+	|| records[handle.record].heapIndex == -1) {
+	return -1;
+    }
+    return handle.record;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Place, SiftUp, SiftDown
+// 	Maintain the heap of pending interrupts: the one that fires next
+//	is at heap[0], and each one fires no later than the two below it,
+//	at heap[2i+1] and heap[2i+2].  Each record is told where it is.
+//----------------------------------------------------------------------
+
+void
+Interrupt::Place(int i, int record) {
+    heap[i] = record;
+    records[record].heapIndex = i;
+}
+
+void
+Interrupt::SiftUp(int i) {
+    int record = heap[i];
+    int parent;
+
+    while (i > 0) {
+	parent = (i - 1) / 2;
+	if (!records[heap[parent]].FiresAfter(records[record])) {
+	    break;
+	}
+	Place(i, heap[parent]);
+	i = parent;
+    }
+    Place(i, record);
+}
+
+void
+Interrupt::SiftDown(int i) {
+    int record = heap[i];
+    int n = heap.size();
+    int child;
+
+    while ((child = 2 * i + 1) < n) {
+	if (child + 1 < n
+	    && records[heap[child]].FiresAfter(records[heap[child + 1]])) {
+	    child++;
+	}
+	if (!records[record].FiresAfter(records[heap[child]])) {
+	    break;
+	}
+	Place(i, heap[child]);
+	i = child;
+    }
+    Place(i, record);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Remove
+// 	Take heap[i] off the heap, and put its record back in the pool.
+//	The last one takes its place, and moves to where it belongs.
+//----------------------------------------------------------------------
+
+void
+Interrupt::Remove(int i) {
+    int record = heap[i];
+    int last = heap.back();
+
+    heap.pop_back();
+    if (i < (int) heap.size()) {
+	Place(i, last);
+	SiftUp(i);
+	SiftDown(records[last].heapIndex);
+    }
+    records[record].heapIndex = -1;
+    records[record].generation++;
+    freeRecords.push_back(record);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::RemoveNext
+// 	Take the interrupt that is due next off the heap, and return it.
+//----------------------------------------------------------------------
+
+PendingInterrupt
+Interrupt::RemoveNext() {
+    PendingInterrupt next = records[heap[0]];
+
+    Remove(0);
+    return next;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::CancelAll
+// 	Cancel every pending interrupt.
+//----------------------------------------------------------------------
+
+void
+Interrupt::CancelAll() {
+    while (!heap.empty()) {
+	Remove(heap.size() - 1);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -270,7 +454,7 @@ Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type) {
 //		pending interrupt would occur (if any).
 //----------------------------------------------------------------------
 bool Interrupt::CheckIfDue(bool advanceClock) {
-    PendingInterrupt *next;
+    PendingInterrupt next(NULL, 0, TimerInt);
     Statistics *stats = kernel->stats;
 
     ASSERT(level == IntOff);		// interrupts need to be disabled,
@@ -278,22 +462,22 @@ bool Interrupt::CheckIfDue(bool advanceClock) {
     if (debug->IsEnabled(dbgInt)) {
 	    DumpState();
     }
-    if (pending->IsEmpty()) {   	// no pending interrupts
+    if (heap.empty()) {   	// no pending interrupts
 	    return FALSE;	
     }		
-    next = pending->Front();
-    if (next->when > stats->totalTicks) {
+    next = records[heap[0]];
+    if (next.when > stats->totalTicks) {
         if (!advanceClock) {		// not time yet
             return FALSE;
         }
         else {      		// advance the clock to next interrupt
-            stats->idleTicks += (next->when - stats->totalTicks);
-            stats->totalTicks = next->when;
+            stats->idleTicks += (next.when - stats->totalTicks);
+            stats->totalTicks = next.when;
         }
     }
 
     DEBUG(dbgInt, "Invoking interrupt handler for the ");
-    DEBUG(dbgInt, intTypeNames[next->type] << " at time " << next->when);
+    DEBUG(dbgInt, intTypeNames[next.type] << " at time " << next.when);
 #ifdef USER_PROGRAM
     if (kernel->machine != NULL) {
     	kernel->machine->DelayedLoad(0, 0);
@@ -301,11 +485,10 @@ bool Interrupt::CheckIfDue(bool advanceClock) {
 #endif
     inHandler = TRUE;
     do {
-        next = pending->RemoveFront();    // pull interrupt off list
-        next->callOnInterrupt->CallBack();// call the interrupt handler
-	    delete next;
-    } while (!pending->IsEmpty() 
-    		&& (pending->Front()->when <= stats->totalTicks));
+        next = RemoveNext();		// pull interrupt off the heap
+        next.callOnInterrupt->CallBack();// call the interrupt handler
+    } while (!heap.empty() 
+    		&& (records[heap[0]].when <= stats->totalTicks));
     inHandler = FALSE;
     return TRUE;
 }
@@ -321,6 +504,18 @@ static void PrintPending (PendingInterrupt *pending) {
     cout << ", scheduled at " << pending->when;
 }
 
+//----------------------------------------------------------------------
+// FiresBefore
+//	For DumpState, to print the pending interrupts in the order they
+//	will fire.
+//----------------------------------------------------------------------
+
+static bool
+FiresBefore(const PendingInterrupt &x, const PendingInterrupt &y)
+{
+    return y.FiresAfter(x);
+}
+
 //----------------------------------------------------------------------
 // DumpState
 // 	Print the complete interrupt state - the status, and all interrupts
@@ -331,6 +526,158 @@ void Interrupt::DumpState() {
     cout << "Time: " << kernel->stats->totalTicks;
     cout << ", interrupts " << intLevelNames[level] << "\n";
     cout << "Pending interrupts:\n";
-    pending->Apply(PrintPending);
+    std::vector<PendingInterrupt> inOrder;
+
+    for (unsigned int i = 0; i < heap.size(); i++) {
+	inOrder.push_back(records[heap[i]]);
+    }
+    std::sort(inOrder.begin(), inOrder.end(), FiresBefore);
+    for (unsigned int i = 0; i < inOrder.size(); i++) {
+	PrintPending(&inOrder[i]);
+    }
     cout << "\nEnd of pending interrupts\n";
 }
+
+//----------------------------------------------------------------------
+// TestDevice
+// 	A device for Interrupt::SelfTest, that interrupts "count" times,
+//	one request after another: every "period" ticks, as the timer
+//	does, or if "period" is 0, after a seek and a rotation that vary
+//	from one request to the next, as the disk does.  Each interrupt
+//	checks that it came when it was due, and after the one before
+//	it, of any device: later, or at the same time but scheduled
+//	earlier.
+//----------------------------------------------------------------------
+
+class TestDevice : public CallBackObj {
+  public:
+    TestDevice(Interrupt *ints, IntType kind, int period, int count);
+
+    void Request();		// schedule the next interrupt
+    void Delay(int fromNow);	// move the pending one "fromNow" ticks 
+				// from now, if there is one
+    void Stop();		// cancel the pending one, and all the rest
+    void CallBack();		// the interrupt
+    int Left() { return left; }
+
+    static Ticks lastDue;	// when the last interrupt, of any device,
+    static unsigned int lastOrder;	// was due, and its place
+    static unsigned int made;	// # of requests made, of any device
+
+  private:
+    Interrupt *interrupt;
+    IntType type;
+    int period;
+    int left;			// # of interrupts still to come
+    int requests;		// # of requests made
+    Ticks due;			// when the pending one is due
+    unsigned int order;		// # of requests made before it
+    InterruptHandle pending;
+};
+
+Ticks TestDevice::lastDue = 0;
+unsigned int TestDevice::lastOrder = 0;
+unsigned int TestDevice::made = 0;
+
+TestDevice::TestDevice(Interrupt *ints, IntType kind, int period, int count)
+{
+    interrupt = ints;
+    type = kind;
+    this->period = period;
+    left = count;
+    requests = 0;
+}
+
+void
+TestDevice::Request()
+{
+    int latency = period;
+
+    if (period == 0) {
+	latency = (requests % 4) * SeekTime + (requests % 3 + 1) * RotationTime;
+    }
+    requests++;
+    due = kernel->stats->totalTicks + latency;
+    order = made++;
+    pending = interrupt->Schedule(this, latency, type);
+}
+
+void
+TestDevice::Delay(int fromNow)
+{
+    if (interrupt->Reschedule(pending, fromNow)) {
+	due = kernel->stats->totalTicks + fromNow;
+	order = made++;
+    }
+}
+
+void
+TestDevice::Stop()
+{
+    bool cancelled = interrupt->Cancel(pending);
+
+    ASSERT(cancelled && !interrupt->IsPending(pending));
+    left = 0;
+}
+
+void
+TestDevice::CallBack()
+{
+    ASSERT(left > 0);
+    ASSERT(kernel->stats->totalTicks == due);
+    ASSERT(due > lastDue || (due == lastDue && order > lastOrder));
+    lastDue = due;
+    lastOrder = order;
+    if (--left > 0) {
+	Request();
+    }
+}
+
+//----------------------------------------------------------------------
+// Interrupt::SelfTest
+// 	Test that interrupts fire when they are due, and in order, as the
+//	clock goes past 2^32 ticks.  We run timer-like, disk-like and
+//	console-like devices on an interrupt queue of our own, starting
+//	just short of 2^32, moving the timer's interrupt now and then, 
+//	as Timer::Reprogram does, and cancelling the console part way.
+//	The clock is put back afterwards.
+//----------------------------------------------------------------------
+
+void
+Interrupt::SelfTest()
+{
+    Statistics *stats = kernel->stats;
+    Ticks totalTicks = stats->totalTicks;
+    Ticks idleTicks = stats->idleTicks;
+    Interrupt *ints = new Interrupt();
+    TestDevice *timer = new TestDevice(ints, TimerInt, TimerTicks, 400);
+    TestDevice *disk = new TestDevice(ints, DiskInt, 0, 40);
+    TestDevice *console = new TestDevice(ints, ConsoleWriteInt, ConsoleTime, 
+					 400);
+    int rounds = 0;
+
+    DEBUG(dbgInt, "Entering Interrupt::SelfTest");
+    stats->totalTicks = 0xffffffffLL - 50 * TimerTicks;
+    TestDevice::lastDue = stats->totalTicks;
+    timer->Request();
+    disk->Request();
+    console->Request();
+    while (ints->CheckIfDue(TRUE)) {
+	rounds++;
+	if (rounds % 5 == 0) {
+	    timer->Delay(TimerTicks * (rounds % 3 + 1));
+	}
+	if (rounds == 150) {
+	    console->Stop();
+	}
+    }
+    ASSERT(timer->Left() == 0 && disk->Left() == 0 && console->Left() == 0);
+    ASSERT(stats->totalTicks > 0xffffffffLL + 50 * TimerTicks);
+
+    stats->totalTicks = totalTicks;
+    stats->idleTicks = idleTicks;
+    delete timer;
+    delete disk;
+    delete console;
+    delete ints;
+}
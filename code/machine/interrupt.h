@@ -36,8 +36,10 @@
 #define INTERRUPT_H
 
 #include "copyright.h"
+#include "utility.h"
 #include "list.h"
 #include "callback.h"
+#include <vector>
 
 // Interrupts can be disabled (IntOff) or enabled (IntOn)
 enum IntStatus { IntOff, IntOn };
@@ -49,9 +51,13 @@ enum MachineStatus {IdleMode, SystemMode, UserMode};
 
 // IntType records which hardware device generated an interrupt.
 // In Nachos, we support a hardware timer device, a disk, a console
-// display and keyboard, and a network.
+// display and keyboard, and a network.  AlarmInt is the alarm clock's
+// wakeup for sleeping threads (see sleepFunc), not the timer's tick.
 enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
-			ElevatorInt, NetworkSendInt, NetworkRecvInt};
+			ElevatorInt, NetworkSendInt, NetworkRecvInt, AlarmInt};
+
+// What Interrupt::NextDue returns when no interrupt is scheduled.
+const Ticks NeverDue = 0x7fffffffffffffffLL;
 
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
@@ -59,15 +65,41 @@ enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt,
 
 class PendingInterrupt {
   public:
-    PendingInterrupt(CallBackObj *callOnInt, int time, IntType kind);
+    PendingInterrupt(CallBackObj *callOnInt, Ticks time, IntType kind);
 				// initialize an interrupt that will
 				// occur in the future
 
     CallBackObj *callOnInterrupt;// The object (in the hardware device
 				// emulator) to call when the interrupt occurs
     
-    int when;			// When the interrupt is supposed to fire
+    Ticks when;			// When the interrupt is supposed to fire
     IntType type;		// for debugging
+    unsigned int order;		// # of interrupts scheduled before it, so
+				// those due at the same time fire in the
+				// order they were scheduled
+    int heapIndex;		// where it is in the heap of pending
+				// interrupts, or -1 if the record is free
+    unsigned int generation;	// # of times the record has been freed,
+				// to tell old handles on it from new
+
+    bool FiresAfter(const PendingInterrupt &other) const
+	{ return when > other.when 
+		 || (when == other.when && (int) (order - other.order) > 0); }
+				// Is this one due later than "other"?
+};
+
+// What Interrupt::Schedule returns: a handle on the interrupt, to
+// cancel it or change when it fires.  Once the interrupt has fired,
+// or been cancelled, the handle is stale, and Cancel and Reschedule
+// ignore it, even though its record may have been used again.  A
+// default handle is stale from the start.
+
+class InterruptHandle {
+  public:
+    InterruptHandle() { record = -1; generation = 0; }
+
+    int record;			// which record of the pool, or -1
+    unsigned int generation;	// the record's generation when scheduled
 };
 
 // The following class defines the data structures for the simulation
@@ -103,10 +135,12 @@ class Interrupt {
     void setStatus(MachineStatus st) { status = st; }
         			// idle, kernel, user
 
-    bool AnyFutureInterrupts() { return !pending->IsEmpty(); }
+    bool AnyFutureInterrupts() { return !heap.empty(); }
     				// are any interrupts scheduled?
 
     void DumpState();		// Print interrupt state
+    void SelfTest();		// Test that interrupts fire in order,
+				// past 2^32 ticks
     
 
     // NOTE: the following are internal to the hardware simulation code.
@@ -114,18 +148,36 @@ class Interrupt {
     // but they need to be public since they are called by the
     // hardware device simulators.
 
-    void Schedule(CallBackObj *callTo, int when, IntType type);
+    InterruptHandle Schedule(CallBackObj *callTo, int when, IntType type);
     				// Schedule an interrupt to occur
 				// at time "when".  This is called
     				// by the hardware device simulators.
+    bool Cancel(InterruptHandle handle);
+				// Don't fire it after all; FALSE if it
+				// had already fired, or been cancelled
+    bool Reschedule(InterruptHandle handle, int fromNow);
+				// Fire it "fromNow" ticks from now
+				// instead; FALSE as for Cancel
+    bool IsPending(InterruptHandle handle)
+	{ return FindRecord(handle) != -1; }
+				// Is it still to fire?
     
     void OneTick();       	// Advance simulated time
 
+    Ticks NextDue() 
+	{ return heap.empty() ? NeverDue : records[heap[0]].when; }
+    				// when CheckIfDue will next fire
+				// anything, if the clock gets there
+
   private:
     IntStatus level;		// are interrupts enabled or disabled?
-    SortedList<PendingInterrupt *> *pending;		
-    				// the list of interrupts scheduled
-				// to occur in the future
+    std::vector<PendingInterrupt> records;
+				// the pool of interrupt records
+    std::vector<int> freeRecords;	// the records not in use
+    std::vector<int> heap;	// the records of the interrupts scheduled
+				// to occur in the future: a heap, the
+				// next one first
+    unsigned int scheduled;	// # of interrupts scheduled so far
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
@@ -133,12 +185,28 @@ class Interrupt {
 
     // these functions are internal to the interrupt simulation code
 
+    int FindRecord(InterruptHandle handle);
+				// The record of a pending interrupt, or -1
+    void Place(int i, int record);	// Put a record at heap[i]
+    void SiftUp(int i);		// Restore the heap order, after heap[i]
+    void SiftDown(int i);	// has moved up or down
+    void Remove(int i);		// Take heap[i] off the heap, and free
+				// its record
+    PendingInterrupt RemoveNext();
+				// Take the next interrupt off the heap
+    int NumPending() { return heap.size(); }
+    PendingInterrupt *Pending(int i) { return &records[heap[i]]; }
+				// The pending interrupts, in no order
+    void CancelAll();		// Cancel every pending interrupt
     bool CheckIfDue(bool advanceClock); 
     				// Check if any interrupts are supposed
 				// to occur now, and if so, do them
 
     void ChangeLevel(IntStatus old, 	// SetLevel, without advancing the
 			IntStatus now); // simulated time
+
+    friend class Checkpoint;	// saves and restores the pending
+				// interrupts
 };
 
 #endif // INTERRRUPT_H
@@ -10,6 +10,13 @@
 #include "copyright.h"
 #include "machine.h"
 #include "main.h"
+#include "cache.h"
+#include "tracewriter.h"
+#include "pipeline.h"
+#include "tlb.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 // Textual names of the exceptions that can be generated by user program
 // execution, for debugging.
@@ -42,17 +49,134 @@ static void CheckEndian() {
 #endif
 }
 
+unsigned int NumPhysPages = DefaultPhysPages;
+int MemorySize = DefaultPhysPages * PageSize;
+
+//----------------------------------------------------------------------
+// SetMemorySize
+// 	Give the machine "numPages" frames of main memory, instead of
+//	DefaultPhysPages (nachos -mem).  Everything that depends on the
+//	size of memory is sized when the Machine is made, so this must
+//	come first.
+//----------------------------------------------------------------------
+
+void
+SetMemorySize(unsigned int numPages)
+{
+    ASSERT(numPages > 0 && numPages <= MaxPhysPages);
+    NumPhysPages = numPages;
+    MemorySize = numPages * PageSize;
+}
+
+//----------------------------------------------------------------------
+// HostThreads
+// 	The host threads Machine::RunParallel runs processors on.  Host
+//	thread i runs parallelCpu[i]; the thread calling RunParallel 
+//	runs parallelCpu[0] itself.  They wait for work between runs,
+//	rather than being created for every run.
+//----------------------------------------------------------------------
+
+class HostThreads {
+  public:
+    HostThreads(ParallelCpu **cpus, int n);
+    ~HostThreads();
+    void Run(int n);		// run cpus 0 .. n-1, and wait for them
+
+  private:
+    void Work(int i);		// body of host thread i
+
+    ParallelCpu **cpu;
+    std::vector<std::thread> threads;
+    std::mutex lock;
+    std::condition_variable go;	// signalled to start a run, or to quit
+    std::condition_variable finished;	// signalled when "running" drops
+    unsigned int runs;		// # of runs started so far
+    int toRun;			// # of cpus in the current run
+    int running;		// # of host threads still busy with it
+    bool quit;
+};
+
+HostThreads::HostThreads(ParallelCpu **cpus, int n) {
+    cpu = cpus;
+    runs = 0;
+    toRun = 0;
+    running = 0;
+    quit = FALSE;
+    for (int i = 1; i < n; i++) {
+        threads.push_back(std::thread(&HostThreads::Work, this, i));
+    }
+}
+
+HostThreads::~HostThreads() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        quit = TRUE;
+    }
+    go.notify_all();
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+}
+
+void
+HostThreads::Run(int n) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        toRun = n;
+        running = n - 1;
+        runs++;
+    }
+    go.notify_all();
+    cpu[0]->Run();
+    std::unique_lock<std::mutex> guard(lock);
+    while (running > 0) {
+        finished.wait(guard);
+    }
+}
+
+void
+HostThreads::Work(int i) {
+    unsigned int seen = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            while (!quit && runs == seen) {
+                go.wait(guard);
+            }
+            if (quit) {
+                return;
+            }
+            seen = runs;
+            if (i >= toRun) {
+                continue;		// not needed this time
+            }
+        }
+        cpu[i]->Run();
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            running--;
+        }
+        finished.notify_one();
+    }
+}
+
 //----------------------------------------------------------------------
 // Machine::Machine
 // 	Initialize the simulation of user program execution.
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"type" -- which instruction interpreter to use (see machine.h)
+//
+//	The debugging support in the simulator's inner loops is only 
+//	compiled into the "traced" versions of them (see machine.h), which
+//	we use if "debug" is set or the 'm' or 'a' debug flags are on.
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug) {
+Machine::Machine(bool debug, EngineType type) {
     int i;
-    ReverseTable = (ReverseTranslationEntry**) new (void* [NumPhysPages]);
+    ReverseTable = new ReverseTranslationEntry*[NumPhysPages];
     for (i = 0; i < NumTotalRegs; i++) {
         registers[i] = 0;
     }
@@ -60,25 +184,37 @@ Machine::Machine(bool debug) {
     for (i = 0; i < MemorySize; i++) {
       	mainMemory[i] = 0;
     }
-    for (i = 0; i < NumPhysPages; i++) {
-        AddrSpace::PushFreeFrame(i);
-        this->ReverseTable[i] = new ReverseTranslationEntry(i);
+    decodeCache = new Instruction[MemorySize / 4];
+    frameDecoded = new bool[NumPhysPages];
+    blockLength = new unsigned char[MemorySize / 4];
+    InvalidateAllFrames();
+    hostTLB = new HostTLBEntry[HostTLBSize];
+    FlushHostTLB();
+    AddrSpace::usedPhyPage = new bool[NumPhysPages];
+    for (unsigned int f = 0; f < NumPhysPages; f++) {
+        AddrSpace::usedPhyPage[f] = FALSE;
+        AddrSpace::PushFreeFrame(f);
+        this->ReverseTable[f] = new ReverseTranslationEntry(f);
     }
     for (i = 1; i < NumSectors; i++){
         AddrSpace::PushFreeSector(i);
     }
 
-#ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
-	tlb[i].valid = FALSE;
+    tlb = NULL;			// the kernel adds one, if need be
     pageTable = NULL;
-#else	// use linear page table
-    tlb = NULL;
-    pageTable = NULL;
-#endif
 
+    engine = type;
+    tracing = debug || ::debug->IsEnabled(dbgMach) || ::debug->IsEnabled(dbgAddr);
+    pendingTicks = 0;
+    kernelEntries = 0;
     singleStep = debug;
+    parallelCpu = NULL;
+    hostThreads = NULL;
+    profiling = FALSE;
+    profile = NULL;
+    icache = dcache = NULL;
+    memTrace = NULL;
+    pipeline = NULL;
     CheckEndian();
 }
 
@@ -89,8 +225,90 @@ Machine::Machine(bool debug) {
 
 Machine::~Machine() {
     delete [] mainMemory;
-    if (tlb != NULL){
-        delete [] tlb;
+    delete [] decodeCache;
+    delete [] frameDecoded;
+    delete [] blockLength;
+    delete [] hostTLB;
+    delete [] AddrSpace::usedPhyPage;
+    delete icache;
+    delete dcache;
+    delete memTrace;		// writes out the rest of the trace
+    delete pipeline;
+    if (hostThreads != NULL) {
+        delete hostThreads;		// stops the host threads
+        for (int i = 0; parallelCpu[i] != NULL; i++) {
+            delete parallelCpu[i];
+        }
+        delete [] parallelCpu;
+    }
+    delete tlb;
+}
+
+//----------------------------------------------------------------------
+// Machine::StartParallel
+// 	Create the processors, and the host threads, that RunParallel
+//	uses to run up to "n" simulated processors at once.
+//
+//	The processors run on the host threads cannot trace, stop in the
+//	debugger, profile, simulate the caches or the pipeline, or record
+//	a trace, so return FALSE, and do nothing, when we are doing any
+//	of those (see machine.h).
+//----------------------------------------------------------------------
+
+bool
+Machine::StartParallel(int n) {
+    ASSERT(hostThreads == NULL && n > 1);
+    if (tracing || profiling || icache != NULL || dcache != NULL
+        || memTrace != NULL || pipeline != NULL || tlb != NULL) {
+        return FALSE;
+    }
+    parallelCpu = new ParallelCpu *[n + 1];
+    for (int i = 0; i < n; i++) {
+        parallelCpu[i] = new ParallelCpu(this);
+    }
+    parallelCpu[n] = NULL;
+    hostThreads = new HostThreads(parallelCpu, n);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::RunParallel
+// 	Run simulated processors 0 .. n-1, each on its own host thread
+//	(see ParallelCpu::Run), and return when all of them have stopped.
+//	The caller has Start'ed them, and will Commit them.
+//----------------------------------------------------------------------
+
+void
+Machine::RunParallel(int n) {
+    ASSERT(hostThreads != NULL);
+    hostThreads->Run(n);
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateAllFrames
+// 	Throw away every predecoded instruction, because all of physical
+//	memory may have been rewritten (for instance, zeroed out when a
+//	new address space is created).
+//----------------------------------------------------------------------
+
+void Machine::InvalidateAllFrames() {
+    for (unsigned int i = 0; i < NumPhysPages; i++) {
+        frameDecoded[i] = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushHostTLB
+// 	Throw away every translation cached by ReadMem and WriteMem.
+//	Must be called whenever a cached translation may have become
+//	wrong: a new page table (AddrSpace::RestoreState), a page leaving
+//	its frame (TranslationEntry::SwapOut), or a page's read-only
+//	bit changing.
+//----------------------------------------------------------------------
+
+void Machine::FlushHostTLB() {
+    for (int i = 0; i < HostTLBSize; i++) {
+        hostTLB[i].virtualPage = -1;
     }
 }
 
@@ -107,6 +325,7 @@ Machine::~Machine() {
 void Machine::RaiseException(ExceptionType which, int badVAddr) {
     DEBUG(dbgMach, "Exception: " << exceptionNames[which]);
     
+    EnterKernel();
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0);			// finish anything in progress
     kernel->interrupt->setStatus(SystemMode);
@@ -116,6 +335,50 @@ void Machine::RaiseException(ExceptionType which, int badVAddr) {
 //	cout << "entering user mode...\n";
 }
 
+//----------------------------------------------------------------------
+// Machine::ChargeTicks
+// 	Add the user ticks we have been counting in pendingTicks (see 
+//	Run and RunBlocks), and any cache stalls, to the statistics.
+//	As in Interrupt::OneTick, only one processor moves the clock.
+//----------------------------------------------------------------------
+
+void
+Machine::ChargeTicks()
+{
+    if (pendingTicks > 0) {
+	if (kernel->scheduler->OnClockCpu()) {
+	    kernel->stats->totalTicks += pendingTicks;
+	}
+	kernel->stats->userTicks += pendingTicks;
+	pendingTicks = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::EnterKernel
+// 	Called just before the kernel gets control in the middle of
+//	executing a user instruction (an exception, or a page fault we
+//	handle inline in Translate).
+//
+//	If we have been counting ticks without charging them, charge
+//	them now, so the kernel sees the same time it would have if we
+//	ticked after every instruction.  And since the kernel may change 
+//	anything -- the page table, memory, even which thread is running
+//	-- tell the run loop to stop counting after this instruction.
+//	The kernel also takes long enough for the pipeline, if we are
+//	timing it, to drain.
+//----------------------------------------------------------------------
+
+void
+Machine::EnterKernel()
+{
+    ChargeTicks();
+    kernelEntries++;
+    if (pipeline != NULL) {
+	pipeline->Drain();
+    }
+}
+
 //----------------------------------------------------------------------
 // Machine::Debugger
 // 	Primitive debugger for user programs.  Note that we can't use
@@ -128,13 +391,13 @@ void Machine::RaiseException(ExceptionType which, int badVAddr) {
 
 void Machine::Debugger() {
     char *buf = new char[80];
-    int num;
+    long long num;
 
     kernel->interrupt->DumpState();
     DumpState();
     cout << kernel->stats->totalTicks << ">";
     cin.get(buf, 80, '\n');
-    if (sscanf(buf, "%d", &num) == 1) {
+    if (sscanf(buf, "%lld", &num) == 1) {
 	    runUntilTime = num;
     } else {
         runUntilTime = 0;
@@ -24,15 +24,23 @@
 #include "copyright.h"
 #include "utility.h"
 #include "translate.h"
+#include <vector>
 
 // Definitions related to the size, and format of user memory
 
 const unsigned int PageSize = 128; 		// set the page size equal to
 					// the disk sector size, for simplicity
 
-const unsigned int NumPhysPages = 16;
-const int MemorySize = (NumPhysPages * PageSize);
+const unsigned int DefaultPhysPages = 16;	// unless nachos -mem says
+const unsigned int MaxPhysPages = 1 << 20;	// otherwise (up to this)
+extern unsigned int NumPhysPages;	// # of frames of main memory
+extern int MemorySize;			// NumPhysPages * PageSize
+extern void SetMemorySize(unsigned int numPages);
+					// Set both, before the Machine is made
 const int TLBSize = 4;			// if there is a TLB, make it small
+					// (unless nachos -tlb says otherwise)
+const int HostTLBSize = 16;		// # of entries in the simulator's own
+					// translation cache; a power of 2
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -82,17 +90,181 @@ enum ExceptionType { NoException,           // Everything ok!
 // The procedures in this class are defined in machine.cc, mipssim.cc, and
 // translate.cc.
 
-class Instruction;
 class Interrupt;
 
+// The instruction interpreters the simulator can use.  Both implement
+// exactly the same instruction semantics (see mipsops.h); they differ
+// only in how they dispatch from one instruction to the next.
+//
+//	SwitchEngine   -- the original: one call to OneInstruction and
+//			  a switch on the opcode per simulated instruction
+//	ThreadedEngine -- computed-goto ("threaded code") dispatch; each
+//			  instruction jumps directly to the next one's
+//			  handler.  Needs GNU C; otherwise we fall back
+//			  to SwitchEngine.
+//	BlockEngine    -- runs a whole basic block at a time, translating
+//			  the PC once per block and charging the clock
+//			  once per block (see Machine::RunBlocks)
+//
+// The default can be chosen when compiling (-DTHREADED_ENGINE), and 
+// overridden at run time (nachos -engine switch|threaded|block).
+
+enum EngineType { SwitchEngine, ThreadedEngine, BlockEngine };
+
+#ifdef THREADED_ENGINE
+const EngineType DefaultEngine = ThreadedEngine;
+#else
+const EngineType DefaultEngine = SwitchEngine;
+#endif
+
+// The simulator's hot paths (the run loops, instruction execution,
+// ReadMem, WriteMem and Translate) are templates on "bool traced", 
+// instantiated once with the debugging support (the 'm' and 'a' 
+// debug messages, the -s debugger, sanity checks) and once without.
+// Machine chooses one when it is created; see Machine::Machine.
+//
+// TRACE is DEBUG for use inside those templates: it compiles to
+// nothing in the untraced version.
+
+#define TRACE(flag,expr)						\
+    if (!traced) {} else DEBUG(flag, expr)
+
+// Pairs of adjacent instructions, common in compiled code, that the 
+// basic block engine executes as one (see Machine::ExecuteFused).
+// Each decoded instruction records whether it starts such a pair.
+
+enum FusionType { NotFused,
+		  FuseLuiOri,		// build a 32-bit constant
+		  FuseLuiAddiu,		//   ditto
+		  FuseLwAddu,		// load, then add
+		  FuseSltBne,		// compare and branch
+		  FuseSltBeq		//   ditto
+};
+
+// The following class defines an instruction, represented in both
+// 	undecoded binary form
+//      decoded to identify
+//	    operation to do
+//	    registers to act on
+//	    any immediate operand value
+
+class Instruction {
+  public:
+    void Decode();	// decode the binary representation of the instruction
+
+    unsigned int value; // binary representation of the instruction
+
+    char opCode;     // Type of instruction.  This is NOT the same as the
+    		     // opcode field from the instruction: see defs in mips.h
+    char rs, rt, rd; // Three registers from instruction.
+    int extra;       // Immediate or target or shamt field or offset.
+                     // Immediates are sign-extended.
+    char fusion;     // FusionType of this instruction and the next one
+};
+
+// The following class defines an entry in the simulator's host-side
+// translation cache (see Machine::ReadMem).  It is not part of the
+// simulated hardware: user programs and the kernel cannot see it,
+// except that the kernel must flush it when translations change.
+
+class HostTLBEntry {
+  public:
+    int virtualPage;		// -1 if the entry is unused
+    char *page;			// where the page starts in mainMemory
+    TranslationEntry *entry;	// where to set the use and dirty bits
+    bool writable;		// FALSE if the page is read-only
+};
+
+class Machine;
+class HostThreads;
+class Profile;
+class Cache;
+class MemTraceWriter;
+class Pipeline;
+class TLB;
+
+// One simulated processor, while Machine::RunParallel runs it on a 
+// host thread of its own (nachos -parallel; see Scheduler::RunParallel).
+// It runs the same instructions as Machine::ExecuteInstruction, but on
+// a copy of the processor's registers, and it never traps to the 
+// kernel: it stops just before the first instruction that would 
+// (a system call, an exception, a page fault).
+//
+// Memory is written in place, with the old contents logged, so that
+// the last instructions it ran can be undone; the use and dirty bits
+// are only set once we know which instructions are kept.  Nothing
+// else is shared, so processors with different address spaces can 
+// run at the same time without locking.
+
+class ParallelCpu {
+  public:
+    ParallelCpu(Machine *m) { machine = m; }
+
+    void Start(int *regs, TranslationEntry *table, unsigned int tableSize,
+	       int count, int quantum);
+				// Get ready to run up to "count" 
+				// instructions of the processor whose
+				// registers are saved in "regs", and 
+				// whose page table is "table"
+    void Run();			// Run them, or until one needs the kernel
+    int Done() { return done; }	// # of instructions Run completed
+    void Commit(int count);	// Keep the effects of just the first
+				// "count" of them -- Done(), or a multiple
+				// of "quantum" -- and undo the rest
+
+  private:
+    class MemoryUndo {		// what a store overwrote
+      public:
+	int when;		// # of the instruction that did it
+	int physAddr;
+	int size;
+	unsigned int old;
+    };
+    class PageUse {		// a translation, to set the bits for
+      public:
+	int when;
+	TranslationEntry *entry;
+	bool writing;
+    };
+
+    bool Step();		// Run the instruction at PC; FALSE if
+				// it needs the kernel (then it has not
+				// changed the registers)
+    bool Translate(int virtAddr, int* physAddr, int size, bool writing);
+    template <bool traced> bool ReadMem(int addr, int size, int* value);
+    template <bool traced> bool WriteMem(int addr, int size, int value);
+				// As for Machine, but FALSE, with nothing
+				// raised, if the kernel would be needed
+    void RaiseException(ExceptionType which, int badVAddr) 
+	{ trapped = TRUE; }	// Stop: this instruction needs the kernel
+    void DelayedLoad(int nextReg, int nextVal);
+
+    Machine *machine;
+    int *home;			// where the registers are kept between runs
+    TranslationEntry *pageTable;
+    unsigned int pageTableSize;
+    int target;			// # of instructions to try to run
+    int quantum;
+    int done;			// # of instructions run so far
+    bool trapped;		// the current instruction needs the kernel
+
+    int registers[NumTotalRegs];
+    std::vector<int> saved;	// copies of the registers, after every
+				// "quantum" instructions
+    std::vector<MemoryUndo> undo;
+    std::vector<PageUse> uses;
+};
+
 class Machine {
   public:
-    Machine(bool debug);	// Initialize the simulation of the hardware
+    Machine(bool debug, EngineType type = DefaultEngine);
+				// Initialize the simulation of the hardware
 				// for running user programs
     ~Machine();			// De-allocate the data structures
 
 // Routines callable by the Nachos kernel
-    void Run();	 		// Run a user program
+    void Run()	 		// Run a user program
+	{ if (tracing) Run<TRUE>(); else Run<FALSE>(); }
 
     int ReadRegister(int num);	// read the contents of a CPU register
 
@@ -119,6 +291,7 @@ class Machine {
 // If "tlb" is non-NULL, the Nachos kernel is responsible for managing
 //	the contents of the TLB.  But the kernel can use any data structure
 //	it wants (eg, segmented paging) for handling TLB cache misses.
+//	There is a TLB in USE_TLB builds, and with nachos -tlb (see tlb.h).
 // 
 // For simplicity, both the page table pointer and the TLB pointer are
 // public.  However, while there can be multiple page tables (one per address
@@ -126,54 +299,171 @@ class Machine {
 // Thus the TLB pointer should be considered as *read-only*, although 
 // the contents of the TLB are free to be modified by the kernel software.
 
-    TranslationEntry *tlb;		// this pointer should be considered 
+    TLB *tlb;				// this pointer should be considered 
 					// "read-only" to Nachos kernel code
 
     TranslationEntry *pageTable;
 	ReverseTranslationEntry **ReverseTable;
     
 	unsigned int pageTableSize;
-    bool ReadMem(int addr, int size, int* value);
+    bool ReadMem(int addr, int size, int* value)
+	{ return tracing ? ReadMem<TRUE>(addr, size, value)
+			 : ReadMem<FALSE>(addr, size, value); }
+    bool WriteMem(int addr, int size, int value)
+	{ return tracing ? WriteMem<TRUE>(addr, size, value)
+			 : WriteMem<FALSE>(addr, size, value); }
+
+    bool CopyIn(int virtAddr, int size, char *buffer);
+				// Copy "size" bytes of virtual memory at
+				// "virtAddr" into the kernel's "buffer"
+    bool CopyOut(int virtAddr, int size, char *buffer);
+				// Copy "size" bytes of "buffer" into virtual
+				// memory at "virtAddr"
+    int CopyStringIn(int virtAddr, char *buffer, int size);
+				// Copy a null-terminated string, of at most
+				// size-1 characters, into "buffer"; return
+				// its length
+				// These three translate once per page, and
+				// raise an exception and return FALSE (-1)
+				// on a bad address.
+
+    void InvalidateFrame(int frame) { frameDecoded[frame] = FALSE; }
+				// The contents of physical page "frame"
+				// changed behind the simulator's back
+				// (swap in/out, zeroing); forget any
+				// instructions we decoded from it.
+    void InvalidateAllFrames();	// Same, for all of physical memory
+
+    void FlushHostTLB();	// The page table, or a mapping or the
+				// read-only bit in it, changed; forget
+				// the translations ReadMem/WriteMem cached
+
+    void DumpState();		// print the user CPU and memory state 
+
+    bool profiling;		// count instructions by PC (nachos -prof)
+    Profile *profile;		// where to count them for the program
+				// now running; NULL if not profiling
+
+    Cache *icache;		// caches in front of instruction fetches,
+    Cache *dcache;		// and of loads and stores; NULL if none
+				// (nachos -icache, -dcache).  Deleted
+				// with the machine.
+    MemTraceWriter *memTrace;	// where to record every fetch, load and
+				// store (nachos -memtrace); NULL if not
+				// recording.  Also deleted with the machine.
+    Pipeline *pipeline;		// the timing of each instruction, if not
+				// just UserTick (nachos -pipeline); NULL
+				// if none.  Deleted with the machine.
+
+    bool StartParallel(int n);	// Get ready to run "n" processors at
+				// once on host threads; FALSE if we can't
+				// (when tracing, profiling, caching,
+				// recording or timing the pipeline)
+    ParallelCpu *GetParallelCpu(int i) { return parallelCpu[i]; }
+    void RunParallel(int n);	// Run processors 0 .. n-1, each on its
+				// own host thread, and wait for them all
+
   private:
 
 	// Routines internal to the machine simulation -- DO NOT call these directly
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
 
-    void OneInstruction(Instruction *instr); 	
-    				// Run one instruction of a user program.
+    template <bool traced> void Run();
+				// Run, with or without debugging support
+    template <bool traced> void OneInstruction();
+				// Run one instruction of a user program.
+    template <bool traced> void ExecuteInstruction(Instruction *instr);
+				// Run the instruction at PC, already fetched
+    template <bool traced> void RunThreaded();
+				// Run a user program with the threaded
+				// interpreter; never returns
+    template <bool traced> void RunBlocks();
+				// Run a user program a basic block at a
+				// time; never returns
+    void ExecuteFused(Instruction *instr);
+				// Run the pair of instructions at PC as one
+    int BlockLength(int physAddr);
+				// # of instructions in the basic block
+				// starting at "physAddr"
+    void ChargeTicks();		// add pendingTicks to the statistics
+    void EnterKernel();		// the kernel is about to run in the
+				// middle of an instruction
+    void TraceInstruction(Instruction *instr);
+				// print the instruction about to execute
+
+    HostTLBEntry *LookupHostTLB(int addr, int size, bool writing);
+				// Return the cached translation for "addr",
+				// or NULL if we must call Translate
+    void FillHostTLB(int addr, TranslationEntry *entry);
+				// Cache the translation Translate just did
+
+    Instruction *FetchDecoded(int physAddr);
+				// Return the predecoded instruction at
+				// "physAddr", decoding its frame if needed
     
-//    bool ReadMem(int addr, int size, int* value);
-    bool WriteMem(int addr, int size, int value);
+    template <bool traced> bool ReadMem(int addr, int size, int* value);
+    template <bool traced> bool WriteMem(int addr, int size, int value);
     				// Read or write 1, 2, or 4 bytes of virtual 
 				// memory (at addr).  Return FALSE if a 
 				// correct translation couldn't be found.
 
-    ExceptionType Translate(int virtAddr, int* physAddr, int size, bool writing);
+    template <bool traced>
+    ExceptionType Translate(int virtAddr, int* physAddr, int size, bool writing,
+			    TranslationEntry **entryPtr = NULL);
     				// Translate an address, and check for 
 				// alignment.  Set the use and dirty bits in 
 				// the translation entry appropriately,
     				// and return an exception code if the 
 				// translation couldn't be completed.
+				// If "entryPtr" is given, also return the
+				// translation entry that was used.
+    ExceptionType TranslateAny(int virtAddr, int* physAddr, bool writing);
+				// Translate, for the kernel's copy routines
 
     void RaiseException(ExceptionType which, int badVAddr);
 				// Trap to the Nachos kernel, because of a
 				// system call or other exception.  
 
     void Debugger();		// invoke the user program debugger
-    void DumpState();		// print the user CPU and memory state 
 
 
 // Internal data structures
 
     int registers[NumTotalRegs]; // CPU registers, for executing user programs
 
+    Instruction *decodeCache;	// decoded copy of every word of mainMemory,
+				// indexed by physical address / 4
+    bool *frameDecoded;		// TRUE if the slots of decodeCache for
+				// this physical page are up to date
+    unsigned char *blockLength;	// for each word of mainMemory, the length
+				// of the basic block starting there, or
+				// 0 if not yet known; valid only while
+				// the frame is decoded
+
+    HostTLBEntry *hostTLB;	// translations for ReadMem and WriteMem,
+				// indexed by virtual page # mod HostTLBSize
+
+    int pendingTicks;		// user ticks already executed but not 
+				// yet added to the statistics
+    unsigned int kernelEntries;	// # of times the kernel has run in the
+				// middle of an instruction; Run and 
+				// RunBlocks stop counting ticks as
+				// soon as this changes
+
+    EngineType engine;		// which interpreter Run uses
+    bool tracing;		// use the traced versions of the hot paths
+
+    ParallelCpu **parallelCpu;	// the processors RunParallel runs, or
+    HostThreads *hostThreads;	// NULL if StartParallel hasn't been called
+
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
-    int runUntilTime;		// drop back into the debugger when simulated
+    Ticks runUntilTime;		// drop back into the debugger when simulated
 				// time reaches this value
 
  	friend class Interrupt;		// calls DelayedLoad()    
+	friend class ParallelCpu;	// calls FetchDecoded()
 };
 
 extern void ExceptionHandler(ExceptionType which);
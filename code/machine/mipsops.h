@@ -0,0 +1,452 @@
+// mipsops.h 
+//	The semantics of each MIPS instruction, shared by the two
+//	interpreters in mipssim.cc.
+//
+//	This file is not a normal header: it is a fragment, #included
+//	in the middle of a function body, once inside the switch in
+//	Machine::OneInstruction, once inside Machine::RunThreaded, and
+//	once in ParallelCpu::Step (which has its own registers, ReadMem,
+//	WriteMem and RaiseException).
+//	The includer defines three macros before including it:
+//
+//	   OPCASE(op)	-- the entry point for opcode "op"
+//	   OPDONE	-- the instruction completed normally
+//	   OPTRAP	-- the instruction raised an exception; the
+//			   exception handler has already run, so skip
+//			   the delayed load and PC update
+//
+//	Several opcodes deliberately fall through into the next one
+//	(e.g., JAL into J), so keep the order of the cases.
+//
+//	The includer also declares instr, pcAfter, nextLoadReg,
+//	nextLoadValue, sum, diff, tmp, value, rs, rt and imm, and is 
+//	a template on "bool traced" (see machine.h).
+//
+//   DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+      OPCASE(OP_ADD):
+		sum = registers[instr->rs] + registers[instr->rt];
+		if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
+			((registers[instr->rs] ^ sum) & SIGN_BIT)) {
+			RaiseException(OverflowException, 0);
+			OPTRAP;
+		}
+		registers[instr->rd] = sum;
+		OPDONE;
+	
+      OPCASE(OP_ADDI):
+		sum = registers[instr->rs] + instr->extra;
+		if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
+			((instr->extra ^ sum) & SIGN_BIT)) {
+			RaiseException(OverflowException, 0);
+			OPTRAP;
+		}
+		registers[instr->rt] = sum;
+		OPDONE;
+	
+      OPCASE(OP_ADDIU):
+		registers[instr->rt] = registers[instr->rs] + instr->extra;
+		OPDONE;
+	
+      OPCASE(OP_ADDU):
+		registers[instr->rd] = registers[instr->rs] + registers[instr->rt];
+		OPDONE;
+	
+      OPCASE(OP_AND):
+		registers[instr->rd] = registers[instr->rs] & registers[instr->rt];
+		OPDONE;
+	
+      OPCASE(OP_ANDI):
+		registers[instr->rt] = registers[instr->rs] & (instr->extra & 0xffff);
+		OPDONE;
+
+      OPCASE(OP_BEQ):
+		if (registers[instr->rs] == registers[instr->rt])
+			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+		OPDONE;
+	
+      OPCASE(OP_BGEZAL):
+		registers[R31] = registers[NextPCReg] + 4;
+      OPCASE(OP_BGEZ):
+		if (!(registers[instr->rs] & SIGN_BIT))
+			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+		OPDONE;
+	
+      OPCASE(OP_BGTZ):
+		if (registers[instr->rs] > 0)
+			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+		OPDONE;
+	
+      OPCASE(OP_BLEZ):
+		if (registers[instr->rs] <= 0)
+			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+		OPDONE;
+	
+      OPCASE(OP_BLTZAL):
+		registers[R31] = registers[NextPCReg] + 4;
+      OPCASE(OP_BLTZ):
+		if (registers[instr->rs] & SIGN_BIT)
+			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+		OPDONE;
+	
+      OPCASE(OP_BNE):
+		if (registers[instr->rs] != registers[instr->rt])
+			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
+		OPDONE;
+	
+      OPCASE(OP_DIV):
+		if (registers[instr->rt] == 0) {
+			registers[LoReg] = 0;
+			registers[HiReg] = 0;
+		} else {
+			registers[LoReg] =  registers[instr->rs] / registers[instr->rt];
+			registers[HiReg] = registers[instr->rs] % registers[instr->rt];
+		}
+		OPDONE;
+	
+      OPCASE(OP_DIVU):	  
+		rs = (unsigned int) registers[instr->rs];
+		rt = (unsigned int) registers[instr->rt];
+		if (rt == 0) {
+			registers[LoReg] = 0;
+			registers[HiReg] = 0;
+		} else {
+			tmp = rs / rt;
+			registers[LoReg] = (int) tmp;
+			tmp = rs % rt;
+			registers[HiReg] = (int) tmp;
+		}
+		OPDONE;
+	
+      OPCASE(OP_JAL):
+		registers[R31] = registers[NextPCReg] + 4;
+      OPCASE(OP_J):
+		pcAfter = (pcAfter & 0xf0000000) | IndexToAddr(instr->extra);
+		OPDONE;
+	
+      OPCASE(OP_JALR):
+		registers[instr->rd] = registers[NextPCReg] + 4;
+      OPCASE(OP_JR):
+		pcAfter = registers[instr->rs];
+		OPDONE;
+	
+      OPCASE(OP_LB):
+      OPCASE(OP_LBU):
+		tmp = registers[instr->rs] + instr->extra;
+		if (!ReadMem<traced>(tmp, 1, &value))
+	    	OPTRAP;
+
+		if ((value & 0x80) && (instr->opCode == OP_LB))
+			value |= 0xffffff00;
+		else
+			value &= 0xff;
+		nextLoadReg = instr->rt;
+		nextLoadValue = value;
+		OPDONE;
+	
+      OPCASE(OP_LH):
+      OPCASE(OP_LHU):	  
+		tmp = registers[instr->rs] + instr->extra;
+		if (tmp & 0x1) {
+			RaiseException(AddressErrorException, tmp);
+			OPTRAP;
+		}
+		if (!ReadMem<traced>(tmp, 2, &value))
+			OPTRAP;
+
+		if ((value & 0x8000) && (instr->opCode == OP_LH))
+			value |= 0xffff0000;
+		else
+			value &= 0xffff;
+		nextLoadReg = instr->rt;
+		nextLoadValue = value;
+		OPDONE;
+      	
+      OPCASE(OP_LUI):
+		TRACE(dbgMach, "Executing: LUI r" << instr->rt << ", " << instr->extra);
+		registers[instr->rt] = instr->extra << 16;
+		OPDONE;
+	
+      OPCASE(OP_LW):
+		tmp = registers[instr->rs] + instr->extra;
+		if (tmp & 0x3) {
+			RaiseException(AddressErrorException, tmp);
+			OPTRAP;
+		}
+		if (!ReadMem<traced>(tmp, 4, &value))
+			OPTRAP;
+		nextLoadReg = instr->rt;
+		nextLoadValue = value;
+		OPDONE;
+			
+      OPCASE(OP_LWL):	  
+		tmp = registers[instr->rs] + instr->extra;
+
+		// ReadMem assumes all 4 byte requests are aligned on an even 
+		// word boundary.  Also, the little endian/big endian swap code would
+			// fail (I think) if the other cases are ever exercised.
+		ASSERT((tmp & 0x3) == 0);  
+
+		if (!ReadMem<traced>(tmp, 4, &value))
+			OPTRAP;
+		if (registers[LoadReg] == instr->rt)
+			nextLoadValue = registers[LoadValueReg];
+		else
+			nextLoadValue = registers[instr->rt];
+		switch (tmp & 0x3) {
+		case 0:
+			nextLoadValue = value;
+			break;
+		case 1:
+			nextLoadValue = (nextLoadValue & 0xff) | (value << 8);
+			break;
+		case 2:
+			nextLoadValue = (nextLoadValue & 0xffff) | (value << 16);
+			break;
+		case 3:
+			nextLoadValue = (nextLoadValue & 0xffffff) | (value << 24);
+			break;
+		}
+		nextLoadReg = instr->rt;
+		OPDONE;
+      	
+      OPCASE(OP_LWR):
+		tmp = registers[instr->rs] + instr->extra;
+
+		// ReadMem assumes all 4 byte requests are aligned on an even 
+		// word boundary.  Also, the little endian/big endian swap code would
+		// fail (I think) if the other cases are ever exercised.
+		ASSERT((tmp & 0x3) == 0);  
+
+		if (!ReadMem<traced>(tmp, 4, &value))
+			OPTRAP;
+		if (registers[LoadReg] == instr->rt)
+			nextLoadValue = registers[LoadValueReg];
+		else
+			nextLoadValue = registers[instr->rt];
+		switch (tmp & 0x3) {
+		case 0:
+			nextLoadValue = (nextLoadValue & 0xffffff00) |
+			((value >> 24) & 0xff);
+			break;
+		case 1:
+			nextLoadValue = (nextLoadValue & 0xffff0000) |
+			((value >> 16) & 0xffff);
+			break;
+		case 2:
+			nextLoadValue = (nextLoadValue & 0xff000000)
+			| ((value >> 8) & 0xffffff);
+			break;
+		case 3:
+			nextLoadValue = value;
+			break;
+		}
+		nextLoadReg = instr->rt;
+		OPDONE;
+			
+      OPCASE(OP_MFHI):
+		registers[instr->rd] = registers[HiReg];
+		OPDONE;
+	
+      OPCASE(OP_MFLO):
+		registers[instr->rd] = registers[LoReg];
+		OPDONE;
+	
+      OPCASE(OP_MTHI):
+		registers[HiReg] = registers[instr->rs];
+		OPDONE;
+	
+      OPCASE(OP_MTLO):
+		registers[LoReg] = registers[instr->rs];
+		OPDONE;
+	
+      OPCASE(OP_MULT):
+		Mult(registers[instr->rs], registers[instr->rt], TRUE,
+			&registers[HiReg], &registers[LoReg]);
+		OPDONE;
+	
+      OPCASE(OP_MULTU):
+		Mult(registers[instr->rs], registers[instr->rt], FALSE,
+			&registers[HiReg], &registers[LoReg]);
+		OPDONE;
+	
+      OPCASE(OP_NOR):
+		registers[instr->rd] = ~(registers[instr->rs] | registers[instr->rt]);
+		OPDONE;
+	
+      OPCASE(OP_OR):
+		registers[instr->rd] = registers[instr->rs] | registers[instr->rs];
+		OPDONE;
+	
+      OPCASE(OP_ORI):
+		registers[instr->rt] = registers[instr->rs] | (instr->extra & 0xffff);
+		OPDONE;
+	
+      OPCASE(OP_SB):
+		if (!WriteMem<traced>((unsigned) (registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
+			OPTRAP;
+		OPDONE;
+	
+      OPCASE(OP_SH):
+		if (!WriteMem<traced>((unsigned) (registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
+			OPTRAP;
+		OPDONE;
+	
+      OPCASE(OP_SLL):
+		registers[instr->rd] = registers[instr->rt] << instr->extra;
+		OPDONE;
+	
+      OPCASE(OP_SLLV):
+		registers[instr->rd] = registers[instr->rt] << (registers[instr->rs] & 0x1f);
+		OPDONE;
+	
+	  OPCASE(OP_SLT):
+		if (registers[instr->rs] < registers[instr->rt])
+			registers[instr->rd] = 1;
+		else
+			registers[instr->rd] = 0;
+		OPDONE;
+	
+      OPCASE(OP_SLTI):
+		if (registers[instr->rs] < instr->extra)
+			registers[instr->rt] = 1;
+		else
+			registers[instr->rt] = 0;
+		OPDONE;
+	
+      OPCASE(OP_SLTIU):	  
+		rs = registers[instr->rs];
+		imm = instr->extra;
+		if (rs < imm)
+			registers[instr->rt] = 1;
+		else
+			registers[instr->rt] = 0;
+		OPDONE;
+      	
+      OPCASE(OP_SLTU):	  
+		rs = registers[instr->rs];
+		rt = registers[instr->rt];
+		if (rs < rt)
+			registers[instr->rd] = 1;
+		else
+			registers[instr->rd] = 0;
+		OPDONE;
+      	
+      OPCASE(OP_SRA):
+		registers[instr->rd] = registers[instr->rt] >> instr->extra;
+		OPDONE;
+	
+      OPCASE(OP_SRAV):
+		registers[instr->rd] = registers[instr->rt] >> (registers[instr->rs] & 0x1f);
+		OPDONE;
+	
+      OPCASE(OP_SRL):
+		tmp = registers[instr->rt];
+		tmp >>= instr->extra;
+		registers[instr->rd] = tmp;
+		OPDONE;
+	
+      OPCASE(OP_SRLV):
+		tmp = registers[instr->rt];
+		tmp >>= (registers[instr->rs] & 0x1f);
+		registers[instr->rd] = tmp;
+		OPDONE;
+	
+      OPCASE(OP_SUB):	  
+		diff = registers[instr->rs] - registers[instr->rt];
+		if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
+			((registers[instr->rs] ^ diff) & SIGN_BIT)) {
+			RaiseException(OverflowException, 0);
+			OPTRAP;
+		}
+		registers[instr->rd] = diff;
+		OPDONE;
+      	
+      OPCASE(OP_SUBU):
+		registers[instr->rd] = registers[instr->rs] - registers[instr->rt];
+		OPDONE;
+		
+      OPCASE(OP_SW):
+		if (!WriteMem<traced>((unsigned) 
+			(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
+			OPTRAP;
+		OPDONE;
+	
+      OPCASE(OP_SWL):	  
+		tmp = registers[instr->rs] + instr->extra;
+
+		// The little endian/big endian swap code would
+        // fail (I think) if the other cases are ever exercised.
+		ASSERT((tmp & 0x3) == 0);  
+
+		if (!ReadMem<traced>((tmp & ~0x3), 4, &value))
+	    	OPTRAP;
+		switch (tmp & 0x3) {
+		case 0:
+			value = registers[instr->rt];
+			break;
+		case 1:
+			value = (value & 0xff000000) | ((registers[instr->rt] >> 8) &
+							0xffffff);
+			break;
+		case 2:
+			value = (value & 0xffff0000) | ((registers[instr->rt] >> 16) &
+							0xffff);
+			break;
+		case 3:
+			value = (value & 0xffffff00) | ((registers[instr->rt] >> 24) &
+							0xff);
+			break;
+		}
+		if (!WriteMem<traced>((tmp & ~0x3), 4, value))
+			OPTRAP;
+		OPDONE;
+    	
+      OPCASE(OP_SWR):	  
+		tmp = registers[instr->rs] + instr->extra;
+
+		// The little endian/big endian swap code would
+        // fail (I think) if the other cases are ever exercised.
+		ASSERT((tmp & 0x3) == 0);  
+
+		if (!ReadMem<traced>((tmp & ~0x3), 4, &value))
+			OPTRAP;
+		switch (tmp & 0x3) {
+		case 0:
+			value = (value & 0xffffff) | (registers[instr->rt] << 24);
+			break;
+		case 1:
+			value = (value & 0xffff) | (registers[instr->rt] << 16);
+			break;
+		case 2:
+			value = (value & 0xff) | (registers[instr->rt] << 8);
+			break;
+		case 3:
+			value = registers[instr->rt];
+			break;
+		}
+		if (!WriteMem<traced>((tmp & ~0x3), 4, value))
+			OPTRAP;
+		OPDONE;
+			
+      OPCASE(OP_SYSCALL):
+		RaiseException(SyscallException, 0);
+		// return; 
+		OPDONE;
+	
+      OPCASE(OP_XOR):
+		registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
+		OPDONE;
+	
+      OPCASE(OP_XORI):
+		registers[instr->rt] = registers[instr->rs] ^ (instr->extra & 0xffff);
+		OPDONE;
+	
+      OPCASE(OP_RES):
+      OPCASE(OP_UNIMP):
+		RaiseException(IllegalInstrException, 0);
+		OPTRAP;
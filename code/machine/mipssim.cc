@@ -16,29 +16,14 @@
 #include "machine.h"
 #include "mipssim.h"
 #include "main.h"
+#include "profile.h"
+#include "cache.h"
+#include "tracewriter.h"
+#include "pipeline.h"
+#include "checkpoint.h"
 
 static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
 
-// The following class defines an instruction, represented in both
-// 	undecoded binary form
-//      decoded to identify
-//	    operation to do
-//	    registers to act on
-//	    any immediate operand value
-
-class Instruction {
-  public:
-    void Decode();	// decode the binary representation of the instruction
-
-    unsigned int value; // binary representation of the instruction
-
-    char opCode;     // Type of instruction.  This is NOT the same as the
-    		     // opcode field from the instruction: see defs in mips.h
-    char rs, rt, rd; // Three registers from instruction.
-    int extra;       // Immediate or target or shamt field or offset.
-                     // Immediates are sign-extended.
-};
-
 //----------------------------------------------------------------------
 // Machine::Run
 // 	Simulate the execution of a user-level program on Nachos.
@@ -46,24 +31,81 @@ class Instruction {
 //
 //	This routine is re-entrant, in that it can be called multiple
 //	times concurrently -- one for each thread executing user code.
+//
+//	Most calls to OneTick after an instruction just advance the clock:
+//	nothing is due yet.  So we look up when the next interrupt is due,
+//	and until then (or until the kernel gets control) we only count
+//	the ticks, and bring the statistics up to date in one go before 
+//	the OneTick that can actually fire something.  The simulated time
+//	of every event is the same as ticking after each instruction.
+//
+//	With more than one processor (-ncpu), the processors take turns
+//	after every instruction (see Scheduler::CpuTick), so we tick 
+//	after every instruction, and always use this loop whatever the
+//	engine.  The profiler (-prof), the caches (-icache, -dcache), the
+//	pipeline (-pipeline) and the trace (-memtrace) also always use 
+//	this loop, as they count in OneInstruction, ReadMem and WriteMem;
+//	and so does a run that is to save a checkpoint (-checkpoint),
+//	which is taken here, between user instructions.  So does a TLB,
+//	which must see every fetch, and the block engine doesn't.
+//
+//	"traced" -- if FALSE, leave out all support for debugging (see 
+//		machine.h); the kernel's Run picks the version to use.
 //----------------------------------------------------------------------
 
+template <bool traced>
 void Machine::Run() {
-    Instruction *instr = new Instruction;  // storage for decoded instruction
-
-    if (debug->IsEnabled('m')) {
+    Ticks limit;
+    unsigned int entries;
+    bool verbose = debug->IsEnabled(dbgInt);	// wants to see every tick
+    bool smp = kernel->scheduler->NumCpus() > 1;
+    bool simple = smp || profiling || icache != NULL || dcache != NULL
+		  || pipeline != NULL || memTrace != NULL || tlb != NULL
+		  || Checkpoint::When() != NeverDue;
+					// only OneInstruction can do these
+
+    if (traced && debug->IsEnabled('m')) {
         cout << "Starting program in thread: " << kernel->currentThread->getName();
 	cout << ", at time: " << kernel->stats->totalTicks << "\n";
     }
     kernel->interrupt->setStatus(UserMode);
+#ifdef __GNUC__
+    if (engine == ThreadedEngine && !simple)
+	RunThreaded<traced>();	// never returns
+#endif
+    if (engine == BlockEngine && !simple)
+	RunBlocks<traced>();	// never returns
     for (;;) {
-        OneInstruction(instr);
-		kernel->interrupt->OneTick();
-		if (singleStep && (runUntilTime <= kernel->stats->totalTicks))
-		Debugger();
+	if ((traced && singleStep) || verbose || smp) {
+	    OneInstruction<traced>();
+	    ChargeTicks();		// cache and pipeline stalls, if any
+	} else {
+	    // we may only count ticks strictly before the deadline
+	    limit = kernel->interrupt->NextDue() - kernel->stats->totalTicks
+			- UserTick;
+	    entries = kernelEntries;
+	    for (;;) {
+		OneInstruction<traced>();
+		if (pendingTicks >= limit || kernelEntries != entries) {
+		    break;
+		}
+		pendingTicks += UserTick;
+	    }
+	    ChargeTicks();
+	}
+	kernel->interrupt->OneTick();
+	if (kernel->stats->totalTicks >= Checkpoint::When())
+	    Checkpoint::Take();
+	if (traced && singleStep && (runUntilTime <= kernel->stats->totalTicks))
+	    Debugger();
     }
 }
 
+// Machine::Run (see machine.h) calls one of these.
+
+template void Machine::Run<TRUE>();
+template void Machine::Run<FALSE>();
+
 
 //----------------------------------------------------------------------
 // TypeToReg
@@ -85,6 +127,25 @@ static int TypeToReg(RegType reg, Instruction *instr) {
     }
 }
 
+//----------------------------------------------------------------------
+// Machine::TraceInstruction
+// 	Disassemble the instruction at the current PC, for the 'm'
+//	debug flag.
+//----------------------------------------------------------------------
+
+void
+Machine::TraceInstruction(Instruction *instr)
+{
+    struct OpString *str = &opStrings[instr->opCode];
+    char buf[80];
+
+    ASSERT(instr->opCode <= MaxOpcode);
+    cout << "At PC = 0x" << std::hex << registers[PCReg] << std::dec;
+    sprintf(buf, str->format, TypeToReg(str->args[0], instr),
+	    TypeToReg(str->args[1], instr), TypeToReg(str->args[2], instr));
+    cout << "\t" << buf << "\n";
+}
+
 //----------------------------------------------------------------------
 // Machine::OneInstruction
 // 	Execute one instruction from a user-level program
@@ -106,29 +167,76 @@ static int TypeToReg(RegType reg, Instruction *instr) {
 //	leaving.  This allows the Nachos kernel to control our behavior
 //	by controlling the contents of memory, the translation table,
 //	and the register set.
+//
+//	The one thing we do cache is the decoded form of each instruction,
+//	kept per physical frame rather than per thread; it is thrown away
+//	whenever the frame it came from is modified.
+//----------------------------------------------------------------------
+
+template <bool traced>
+void Machine::OneInstruction() {
+    ExceptionType exception;
+    int physAddr, pc, thread;
+    Instruction *instr;
+    Profile *counter;
+
+    // Fetch instruction.  We still translate the PC on every fetch, so
+    // that page faults and the use bits the pager relies on behave
+    // exactly as before, but the instruction itself comes already
+    // decoded from the copy we keep for its physical frame.
+    TRACE(dbgAddr, "Fetching VA 0x" << std::hex << registers[PCReg] << std::dec);
+    exception = Translate<traced>(registers[PCReg], &physAddr, 4, FALSE);
+    if (exception != NoException) {
+	RaiseException(exception, registers[PCReg]);
+	return;			// exception occurred
+    }
+    if (icache != NULL) {
+	pendingTicks += icache->Access(physAddr, FALSE);
+    }
+    if (memTrace != NULL) {
+	memTrace->Record(TraceFetch, kernel->currentThread->getId(),
+			 registers[PCReg], physAddr / PageSize);
+    }
+    instr = FetchDecoded(physAddr);
+
+    // Count the instruction if it completed -- if it ran without an
+    // exception, or the kernel moved the PC on past it (a system call);
+    // and profile it, or time it in the pipeline.  The kernel may have
+    // run another program in the meantime, so remember whose it was.
+    pc = registers[PCReg];
+    counter = profile;
+    thread = kernel->currentThread->getId();
+    ExecuteInstruction<traced>(instr);
+    if (registers[PrevPCReg] == pc && registers[PCReg] != pc) {
+	kernel->stats->numUserInstructions++;
+	if (counter != NULL) {
+	    counter->Count(pc, instr, registers[NextPCReg]);
+	}
+	if (pipeline != NULL) {
+	    pendingTicks += pipeline->Account(instr, pc, registers[NextPCReg],
+					      thread);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::ExecuteInstruction
+// 	Execute one already fetched and decoded instruction, the one at
+//	the current PC, and advance the PC past it.  If it raises an
+//	exception, the exception handler has run by the time we return,
+//	and the PC is left alone.
 //----------------------------------------------------------------------
 
-void Machine::OneInstruction(Instruction *instr) {
-    int raw;
+template <bool traced>
+void
+Machine::ExecuteInstruction(Instruction *instr)
+{
     int nextLoadReg = 0; 	
     int nextLoadValue = 0; 	// record delayed load operation, to apply
 				// in the future
 
-    // Fetch instruction 
-    if (!ReadMem(registers[PCReg], 4, &raw))
-	return;			// exception occurred
-    instr->value = raw;
-    instr->Decode();
-
-    if (debug->IsEnabled('m')) {
-        struct OpString *str = &opStrings[instr->opCode];
-		char buf[80];
-
-        ASSERT(instr->opCode <= MaxOpcode);
-        cout << "At PC = 0x" << std::hex << registers[PCReg] << std::dec;
-		sprintf(buf, str->format, TypeToReg(str->args[0], instr),
-	     		TypeToReg(str->args[1], instr), TypeToReg(str->args[2], instr));
-        cout << "\t" << buf << "\n";
+    if (traced && debug->IsEnabled('m')) {
+	TraceInstruction(instr);
     }
     
     // Compute next pc, but don't install in case there's an error or branch.
@@ -139,429 +247,14 @@ void Machine::OneInstruction(Instruction *instr) {
     // Execute the instruction (cf. Kane's book)
     switch (instr->opCode) {
 	
-      case OP_ADD:
-		sum = registers[instr->rs] + registers[instr->rt];
-		if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
-			((registers[instr->rs] ^ sum) & SIGN_BIT)) {
-			RaiseException(OverflowException, 0);
-			return;
-		}
-		registers[instr->rd] = sum;
-		break;
-	
-      case OP_ADDI:
-		sum = registers[instr->rs] + instr->extra;
-		if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
-			((instr->extra ^ sum) & SIGN_BIT)) {
-			RaiseException(OverflowException, 0);
-			return;
-		}
-		registers[instr->rt] = sum;
-		break;
-	
-      case OP_ADDIU:
-		registers[instr->rt] = registers[instr->rs] + instr->extra;
-		break;
-	
-      case OP_ADDU:
-		registers[instr->rd] = registers[instr->rs] + registers[instr->rt];
-		break;
-	
-      case OP_AND:
-		registers[instr->rd] = registers[instr->rs] & registers[instr->rt];
-		break;
-	
-      case OP_ANDI:
-		registers[instr->rt] = registers[instr->rs] & (instr->extra & 0xffff);
-		break;
+#define OPCASE(op)	case op
+#define OPDONE		break
+#define OPTRAP		return
+#include "mipsops.h"
+#undef OPCASE
+#undef OPDONE
+#undef OPTRAP
 
-      case OP_BEQ:
-		if (registers[instr->rs] == registers[instr->rt])
-			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-		break;
-	
-      case OP_BGEZAL:
-		registers[R31] = registers[NextPCReg] + 4;
-      case OP_BGEZ:
-		if (!(registers[instr->rs] & SIGN_BIT))
-			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-		break;
-	
-      case OP_BGTZ:
-		if (registers[instr->rs] > 0)
-			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-		break;
-	
-      case OP_BLEZ:
-		if (registers[instr->rs] <= 0)
-			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-		break;
-	
-      case OP_BLTZAL:
-		registers[R31] = registers[NextPCReg] + 4;
-      case OP_BLTZ:
-		if (registers[instr->rs] & SIGN_BIT)
-			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-		break;
-	
-      case OP_BNE:
-		if (registers[instr->rs] != registers[instr->rt])
-			pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-		break;
-	
-      case OP_DIV:
-		if (registers[instr->rt] == 0) {
-			registers[LoReg] = 0;
-			registers[HiReg] = 0;
-		} else {
-			registers[LoReg] =  registers[instr->rs] / registers[instr->rt];
-			registers[HiReg] = registers[instr->rs] % registers[instr->rt];
-		}
-		break;
-	
-      case OP_DIVU:	  
-		rs = (unsigned int) registers[instr->rs];
-		rt = (unsigned int) registers[instr->rt];
-		if (rt == 0) {
-			registers[LoReg] = 0;
-			registers[HiReg] = 0;
-		} else {
-			tmp = rs / rt;
-			registers[LoReg] = (int) tmp;
-			tmp = rs % rt;
-			registers[HiReg] = (int) tmp;
-		}
-		break;
-	
-      case OP_JAL:
-		registers[R31] = registers[NextPCReg] + 4;
-      case OP_J:
-		pcAfter = (pcAfter & 0xf0000000) | IndexToAddr(instr->extra);
-		break;
-	
-      case OP_JALR:
-		registers[instr->rd] = registers[NextPCReg] + 4;
-      case OP_JR:
-		pcAfter = registers[instr->rs];
-		break;
-	
-      case OP_LB:
-      case OP_LBU:
-		tmp = registers[instr->rs] + instr->extra;
-		if (!ReadMem(tmp, 1, &value))
-	    	return;
-
-		if ((value & 0x80) && (instr->opCode == OP_LB))
-			value |= 0xffffff00;
-		else
-			value &= 0xff;
-		nextLoadReg = instr->rt;
-		nextLoadValue = value;
-		break;
-	
-      case OP_LH:
-      case OP_LHU:	  
-		tmp = registers[instr->rs] + instr->extra;
-		if (tmp & 0x1) {
-			RaiseException(AddressErrorException, tmp);
-			return;
-		}
-		if (!ReadMem(tmp, 2, &value))
-			return;
-
-		if ((value & 0x8000) && (instr->opCode == OP_LH))
-			value |= 0xffff0000;
-		else
-			value &= 0xffff;
-		nextLoadReg = instr->rt;
-		nextLoadValue = value;
-		break;
-      	
-      case OP_LUI:
-		DEBUG(dbgMach, "Executing: LUI r" << instr->rt << ", " << instr->extra);
-		registers[instr->rt] = instr->extra << 16;
-		break;
-	
-      case OP_LW:
-		tmp = registers[instr->rs] + instr->extra;
-		if (tmp & 0x3) {
-			RaiseException(AddressErrorException, tmp);
-			return;
-		}
-		if (!ReadMem(tmp, 4, &value))
-			return;
-		nextLoadReg = instr->rt;
-		nextLoadValue = value;
-		break;
-			
-      case OP_LWL:	  
-		tmp = registers[instr->rs] + instr->extra;
-
-		// ReadMem assumes all 4 byte requests are aligned on an even 
-		// word boundary.  Also, the little endian/big endian swap code would
-			// fail (I think) if the other cases are ever exercised.
-		ASSERT((tmp & 0x3) == 0);  
-
-		if (!ReadMem(tmp, 4, &value))
-			return;
-		if (registers[LoadReg] == instr->rt)
-			nextLoadValue = registers[LoadValueReg];
-		else
-			nextLoadValue = registers[instr->rt];
-		switch (tmp & 0x3) {
-		case 0:
-			nextLoadValue = value;
-			break;
-		case 1:
-			nextLoadValue = (nextLoadValue & 0xff) | (value << 8);
-			break;
-		case 2:
-			nextLoadValue = (nextLoadValue & 0xffff) | (value << 16);
-			break;
-		case 3:
-			nextLoadValue = (nextLoadValue & 0xffffff) | (value << 24);
-			break;
-		}
-		nextLoadReg = instr->rt;
-		break;
-      	
-      case OP_LWR:
-		tmp = registers[instr->rs] + instr->extra;
-
-		// ReadMem assumes all 4 byte requests are aligned on an even 
-		// word boundary.  Also, the little endian/big endian swap code would
-		// fail (I think) if the other cases are ever exercised.
-		ASSERT((tmp & 0x3) == 0);  
-
-		if (!ReadMem(tmp, 4, &value))
-			return;
-		if (registers[LoadReg] == instr->rt)
-			nextLoadValue = registers[LoadValueReg];
-		else
-			nextLoadValue = registers[instr->rt];
-		switch (tmp & 0x3) {
-		case 0:
-			nextLoadValue = (nextLoadValue & 0xffffff00) |
-			((value >> 24) & 0xff);
-			break;
-		case 1:
-			nextLoadValue = (nextLoadValue & 0xffff0000) |
-			((value >> 16) & 0xffff);
-			break;
-		case 2:
-			nextLoadValue = (nextLoadValue & 0xff000000)
-			| ((value >> 8) & 0xffffff);
-			break;
-		case 3:
-			nextLoadValue = value;
-			break;
-		}
-		nextLoadReg = instr->rt;
-		break;
-			
-      case OP_MFHI:
-		registers[instr->rd] = registers[HiReg];
-		break;
-	
-      case OP_MFLO:
-		registers[instr->rd] = registers[LoReg];
-		break;
-	
-      case OP_MTHI:
-		registers[HiReg] = registers[instr->rs];
-		break;
-	
-      case OP_MTLO:
-		registers[LoReg] = registers[instr->rs];
-		break;
-	
-      case OP_MULT:
-		Mult(registers[instr->rs], registers[instr->rt], TRUE,
-			&registers[HiReg], &registers[LoReg]);
-		break;
-	
-      case OP_MULTU:
-		Mult(registers[instr->rs], registers[instr->rt], FALSE,
-			&registers[HiReg], &registers[LoReg]);
-		break;
-	
-      case OP_NOR:
-		registers[instr->rd] = ~(registers[instr->rs] | registers[instr->rt]);
-		break;
-	
-      case OP_OR:
-		registers[instr->rd] = registers[instr->rs] | registers[instr->rs];
-		break;
-	
-      case OP_ORI:
-		registers[instr->rt] = registers[instr->rs] | (instr->extra & 0xffff);
-		break;
-	
-      case OP_SB:
-		if (!WriteMem((unsigned) (registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
-			return;
-		break;
-	
-      case OP_SH:
-		if (!WriteMem((unsigned) (registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
-			return;
-		break;
-	
-      case OP_SLL:
-		registers[instr->rd] = registers[instr->rt] << instr->extra;
-		break;
-	
-      case OP_SLLV:
-		registers[instr->rd] = registers[instr->rt] << (registers[instr->rs] & 0x1f);
-		break;
-	
-	  case OP_SLT:
-		if (registers[instr->rs] < registers[instr->rt])
-			registers[instr->rd] = 1;
-		else
-			registers[instr->rd] = 0;
-		break;
-	
-      case OP_SLTI:
-		if (registers[instr->rs] < instr->extra)
-			registers[instr->rt] = 1;
-		else
-			registers[instr->rt] = 0;
-		break;
-	
-      case OP_SLTIU:	  
-		rs = registers[instr->rs];
-		imm = instr->extra;
-		if (rs < imm)
-			registers[instr->rt] = 1;
-		else
-			registers[instr->rt] = 0;
-		break;
-      	
-      case OP_SLTU:	  
-		rs = registers[instr->rs];
-		rt = registers[instr->rt];
-		if (rs < rt)
-			registers[instr->rd] = 1;
-		else
-			registers[instr->rd] = 0;
-		break;
-      	
-      case OP_SRA:
-		registers[instr->rd] = registers[instr->rt] >> instr->extra;
-		break;
-	
-      case OP_SRAV:
-		registers[instr->rd] = registers[instr->rt] >> (registers[instr->rs] & 0x1f);
-		break;
-	
-      case OP_SRL:
-		tmp = registers[instr->rt];
-		tmp >>= instr->extra;
-		registers[instr->rd] = tmp;
-		break;
-	
-      case OP_SRLV:
-		tmp = registers[instr->rt];
-		tmp >>= (registers[instr->rs] & 0x1f);
-		registers[instr->rd] = tmp;
-		break;
-	
-      case OP_SUB:	  
-		diff = registers[instr->rs] - registers[instr->rt];
-		if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
-			((registers[instr->rs] ^ diff) & SIGN_BIT)) {
-			RaiseException(OverflowException, 0);
-			return;
-		}
-		registers[instr->rd] = diff;
-		break;
-      	
-      case OP_SUBU:
-		registers[instr->rd] = registers[instr->rs] - registers[instr->rt];
-		break;
-		
-      case OP_SW:
-		if (!WriteMem((unsigned) 
-			(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
-			return;
-		break;
-	
-      case OP_SWL:	  
-		tmp = registers[instr->rs] + instr->extra;
-
-		// The little endian/big endian swap code would
-        // fail (I think) if the other cases are ever exercised.
-		ASSERT((tmp & 0x3) == 0);  
-
-		if (!ReadMem((tmp & ~0x3), 4, &value))
-	    	return;
-		switch (tmp & 0x3) {
-		case 0:
-			value = registers[instr->rt];
-			break;
-		case 1:
-			value = (value & 0xff000000) | ((registers[instr->rt] >> 8) &
-							0xffffff);
-			break;
-		case 2:
-			value = (value & 0xffff0000) | ((registers[instr->rt] >> 16) &
-							0xffff);
-			break;
-		case 3:
-			value = (value & 0xffffff00) | ((registers[instr->rt] >> 24) &
-							0xff);
-			break;
-		}
-		if (!WriteMem((tmp & ~0x3), 4, value))
-			return;
-		break;
-    	
-      case OP_SWR:	  
-		tmp = registers[instr->rs] + instr->extra;
-
-		// The little endian/big endian swap code would
-        // fail (I think) if the other cases are ever exercised.
-		ASSERT((tmp & 0x3) == 0);  
-
-		if (!ReadMem((tmp & ~0x3), 4, &value))
-			return;
-		switch (tmp & 0x3) {
-		case 0:
-			value = (value & 0xffffff) | (registers[instr->rt] << 24);
-			break;
-		case 1:
-			value = (value & 0xffff) | (registers[instr->rt] << 16);
-			break;
-		case 2:
-			value = (value & 0xff) | (registers[instr->rt] << 8);
-			break;
-		case 3:
-			value = registers[instr->rt];
-			break;
-		}
-		if (!WriteMem((tmp & ~0x3), 4, value))
-			return;
-		break;
-			
-      case OP_SYSCALL:
-		RaiseException(SyscallException, 0);
-		// return; 
-		break;
-	
-      case OP_XOR:
-		registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
-		break;
-	
-      case OP_XORI:
-		registers[instr->rt] = registers[instr->rs] ^ (instr->extra & 0xffff);
-		break;
-	
-      case OP_RES:
-      case OP_UNIMP:
-		RaiseException(IllegalInstrException, 0);
-		return;
-	
       default:
 		ASSERT(FALSE);
     }
@@ -578,6 +271,467 @@ void Machine::OneInstruction(Instruction *instr) {
     registers[NextPCReg] = pcAfter;
 }
 
+#ifdef __GNUC__
+//----------------------------------------------------------------------
+// Machine::RunThreaded
+// 	Simulate the execution of a user-level program, like Run and
+//	OneInstruction together, but with "threaded code" dispatch.
+//
+//	Every opcode has a label (see mipsops.h), and the end of each
+//	one's handler does all the per-instruction bookkeeping -- the
+//	delayed load, the PC update, the clock tick, and fetching the
+//	next instruction -- and then jumps straight to the next
+//	instruction's label, using GNU C's "labels as values".  There is
+//	no shared switch for the host's branch predictor to get confused
+//	by, and no function call per instruction.
+//
+//	Exceptions and interrupts behave exactly as they do for
+//	OneInstruction: after the kernel's handler returns we re-start
+//	from the machine registers, so nothing is cached across a trap
+//	other than the decoded instructions (see FetchDecoded).
+//
+//	Never returns.
+//----------------------------------------------------------------------
+
+// Tick the clock, and check for the debugger, after every instruction
+// whether or not it completed (same as the loop in Run).
+#define TICK								\
+    kernel->interrupt->OneTick();					\
+    if (traced && singleStep && (runUntilTime <= kernel->stats->totalTicks))	\
+	Debugger()
+
+// Fetch the instruction at PC and jump to its handler.
+#define DISPATCH							\
+    do {								\
+	TRACE(dbgAddr, "Fetching VA 0x" << std::hex << registers[PCReg] << std::dec); \
+	exception = Translate<traced>(registers[PCReg], &physAddr, 4, FALSE); \
+	if (exception != NoException) {					\
+	    RaiseException(exception, registers[PCReg]);		\
+	    goto trapped;						\
+	}								\
+	instr = FetchDecoded(physAddr);					\
+	if (traceInstrs)						\
+	    TraceInstruction(instr);					\
+	pcAfter = registers[NextPCReg] + 4;				\
+	nextLoadReg = 0;						\
+	nextLoadValue = 0;						\
+	goto *dispatch[(int) instr->opCode];				\
+    } while (0)
+
+#define OPCASE(op)	L_##op
+#define OPDONE								\
+    do {								\
+	DelayedLoad(nextLoadReg, nextLoadValue);			\
+	registers[PrevPCReg] = registers[PCReg];			\
+	registers[PCReg] = registers[NextPCReg];			\
+	registers[NextPCReg] = pcAfter;					\
+	kernel->stats->numUserInstructions++;				\
+	TICK;								\
+	DISPATCH;							\
+    } while (0)
+#define OPTRAP		goto trapped
+
+template <bool traced>
+void
+Machine::RunThreaded()
+{
+    void *dispatch[MaxOpcode + 1];
+    Instruction *instr;
+    ExceptionType exception;
+    int physAddr;
+    int pcAfter, nextLoadReg, nextLoadValue;
+    int sum, diff, tmp, value;
+    unsigned int rs, rt, imm;
+    bool traceInstrs = traced && debug->IsEnabled('m');
+    int i;
+
+    DEBUG(dbgMach, "Using the threaded interpreter");
+    for (i = 0; i <= MaxOpcode; i++) {
+	dispatch[i] = &&L_default;	// opcodes the switch has no case for
+    }
+    dispatch[OP_ADD] = &&L_OP_ADD;
+    dispatch[OP_ADDI] = &&L_OP_ADDI;
+    dispatch[OP_ADDIU] = &&L_OP_ADDIU;
+    dispatch[OP_ADDU] = &&L_OP_ADDU;
+    dispatch[OP_AND] = &&L_OP_AND;
+    dispatch[OP_ANDI] = &&L_OP_ANDI;
+    dispatch[OP_BEQ] = &&L_OP_BEQ;
+    dispatch[OP_BGEZ] = &&L_OP_BGEZ;
+    dispatch[OP_BGEZAL] = &&L_OP_BGEZAL;
+    dispatch[OP_BGTZ] = &&L_OP_BGTZ;
+    dispatch[OP_BLEZ] = &&L_OP_BLEZ;
+    dispatch[OP_BLTZ] = &&L_OP_BLTZ;
+    dispatch[OP_BLTZAL] = &&L_OP_BLTZAL;
+    dispatch[OP_BNE] = &&L_OP_BNE;
+    dispatch[OP_DIV] = &&L_OP_DIV;
+    dispatch[OP_DIVU] = &&L_OP_DIVU;
+    dispatch[OP_J] = &&L_OP_J;
+    dispatch[OP_JAL] = &&L_OP_JAL;
+    dispatch[OP_JALR] = &&L_OP_JALR;
+    dispatch[OP_JR] = &&L_OP_JR;
+    dispatch[OP_LB] = &&L_OP_LB;
+    dispatch[OP_LBU] = &&L_OP_LBU;
+    dispatch[OP_LH] = &&L_OP_LH;
+    dispatch[OP_LHU] = &&L_OP_LHU;
+    dispatch[OP_LUI] = &&L_OP_LUI;
+    dispatch[OP_LW] = &&L_OP_LW;
+    dispatch[OP_LWL] = &&L_OP_LWL;
+    dispatch[OP_LWR] = &&L_OP_LWR;
+    dispatch[OP_MFHI] = &&L_OP_MFHI;
+    dispatch[OP_MFLO] = &&L_OP_MFLO;
+    dispatch[OP_MTHI] = &&L_OP_MTHI;
+    dispatch[OP_MTLO] = &&L_OP_MTLO;
+    dispatch[OP_MULT] = &&L_OP_MULT;
+    dispatch[OP_MULTU] = &&L_OP_MULTU;
+    dispatch[OP_NOR] = &&L_OP_NOR;
+    dispatch[OP_OR] = &&L_OP_OR;
+    dispatch[OP_ORI] = &&L_OP_ORI;
+    dispatch[OP_SB] = &&L_OP_SB;
+    dispatch[OP_SH] = &&L_OP_SH;
+    dispatch[OP_SLL] = &&L_OP_SLL;
+    dispatch[OP_SLLV] = &&L_OP_SLLV;
+    dispatch[OP_SLT] = &&L_OP_SLT;
+    dispatch[OP_SLTI] = &&L_OP_SLTI;
+    dispatch[OP_SLTIU] = &&L_OP_SLTIU;
+    dispatch[OP_SLTU] = &&L_OP_SLTU;
+    dispatch[OP_SRA] = &&L_OP_SRA;
+    dispatch[OP_SRAV] = &&L_OP_SRAV;
+    dispatch[OP_SRL] = &&L_OP_SRL;
+    dispatch[OP_SRLV] = &&L_OP_SRLV;
+    dispatch[OP_SUB] = &&L_OP_SUB;
+    dispatch[OP_SUBU] = &&L_OP_SUBU;
+    dispatch[OP_SW] = &&L_OP_SW;
+    dispatch[OP_SWL] = &&L_OP_SWL;
+    dispatch[OP_SWR] = &&L_OP_SWR;
+    dispatch[OP_XOR] = &&L_OP_XOR;
+    dispatch[OP_XORI] = &&L_OP_XORI;
+    dispatch[OP_SYSCALL] = &&L_OP_SYSCALL;
+    dispatch[OP_UNIMP] = &&L_OP_UNIMP;
+    dispatch[OP_RES] = &&L_OP_RES;
+
+    DISPATCH;
+
+#include "mipsops.h"
+
+  L_default:
+    ASSERT(FALSE);
+
+  trapped:			// the exception handler has run; re-start
+    TICK;			// from whatever state it left behind
+    DISPATCH;
+}
+
+#undef OPCASE
+#undef OPDONE
+#undef OPTRAP
+#undef DISPATCH
+#undef TICK
+#endif // __GNUC__
+
+//----------------------------------------------------------------------
+// Machine::RunBlocks
+// 	Simulate the execution of a user-level program, a basic block
+//	at a time.
+//
+//	A basic block is a run of instructions in one physical page
+//	that ends with a branch or jump (plus its delay slot), a
+//	syscall, or the end of the page.  Once we know we are at the
+//	start of one, we translate the PC only once, and charge the
+//	clock for the whole block in one go when it finishes, instead
+//	of calling OneTick after every instruction.
+//
+//	This must not change what the program or the kernel can see.
+//	So we only run a block as a unit when no interrupt is due 
+//	before its last instruction; otherwise we single-step it, as 
+//	Run would.  If the kernel gets control in the middle of a block
+//	(an exception or a page fault), EnterKernel brings the clock up
+//	to date first, and the block stops right after that instruction.
+//
+//	We also single-step whenever someone is watching closely: in
+//	the debugger, or with the 'i' or 'a' debug flags on.
+//
+//	Within a block, a pair of instructions that FuseInstructions 
+//	recognized is run as one by ExecuteFused (except when tracing,
+//	so that every instruction still shows up).
+//
+//	Never returns.
+//----------------------------------------------------------------------
+
+template <bool traced>
+void
+Machine::RunBlocks()
+{
+    ExceptionType exception;
+    TranslationEntry *entry;
+    Instruction *instr;
+    int physAddr, frame, length, i, pc;
+    unsigned int entries;
+    bool verbose = debug->IsEnabled(dbgInt) || debug->IsEnabled(dbgAddr);
+
+    DEBUG(dbgMach, "Using the basic block interpreter");
+    for (;;) {
+	// Single-step if we might be in a branch delay slot (the block
+	// assumes it runs straight through), or if we are being watched.
+	if ((traced && singleStep) || verbose
+	    || registers[NextPCReg] != registers[PCReg] + 4) {
+	    OneInstruction<traced>();
+	    kernel->interrupt->OneTick();
+	    if (traced && singleStep && (runUntilTime <= kernel->stats->totalTicks))
+		Debugger();
+	    continue;
+	}
+
+	exception = Translate<traced>(registers[PCReg], &physAddr, 4, FALSE, &entry);
+	if (exception != NoException) {
+	    RaiseException(exception, registers[PCReg]);
+	    kernel->interrupt->OneTick();
+	    continue;
+	}
+	length = BlockLength(physAddr);
+	if (kernel->interrupt->NextDue() <= kernel->stats->totalTicks
+					    + (length - 1) * UserTick) {
+	    length = 1;		// an interrupt is due inside the block
+	}
+
+	frame = physAddr / PageSize;
+	instr = &decodeCache[physAddr / 4];
+	entries = kernelEntries;
+	for (i = 1; ; i++, instr++) {
+	    pc = registers[PCReg];
+	    if (!traced && instr->fusion != NotFused && i < length) {
+		ExecuteFused(instr);
+		if (kernelEntries == entries) {	// both halves ran
+		    i++;
+		    instr++;
+		    pendingTicks += UserTick;
+		    entry->refCount++;
+		}
+	    } else {
+		ExecuteInstruction<traced>(instr);
+	    }
+	    if (i == length || kernelEntries != entries || !frameDecoded[frame]) {
+		break;		// done, or the kernel ran, or the block
+				// overwrote itself
+	    }
+	    pendingTicks += UserTick;
+	    entry->refCount++;	// as if we had fetched the next one
+				// through Translate
+	}
+	// All but the last instruction completed; so did the last, unless
+	// it trapped (same test as in OneInstruction).
+	kernel->stats->numUserInstructions += i - 1;
+	if (kernelEntries == entries
+	    || (registers[PrevPCReg] == pc && registers[PCReg] != pc)) {
+	    kernel->stats->numUserInstructions++;
+	}
+	ChargeTicks();		// charge for all but the last instruction;
+	kernel->interrupt->OneTick();	// and the last one, as usual
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::ExecuteFused
+// 	Run the instruction at PC, and the one after it, as one.  Only
+//	the block engine calls this, in the middle of a block: so the 
+//	pair is on one page, PC is not in a delay slot, and no interrupt
+//	can come between the two halves.
+//
+//	The result must be exactly what ExecuteInstruction would have 
+//	done twice -- including the delayed load between the halves, 
+//	which means the add of a lw+addu still sees the old value of the
+//	register being loaded.  Only the first half of a pair can trap 
+//	(a lw); if it does, or if the kernel ran to handle a page fault,
+//	we stop after the first half, and the caller stops the block.
+//----------------------------------------------------------------------
+
+void
+Machine::ExecuteFused(Instruction *instr)
+{
+    Instruction *next = instr + 1;
+    int pc = registers[PCReg];
+    int pcAfter = pc + 12;
+    unsigned int entries = kernelEntries;
+    int tmp, value;
+
+    switch (instr->fusion) {
+      case FuseLuiOri:
+	registers[instr->rt] = instr->extra << 16;
+	DelayedLoad(0, 0);
+	registers[next->rt] = registers[next->rs] | (next->extra & 0xffff);
+	kernel->stats->numFusedLuiOri++;
+	break;
+
+      case FuseLuiAddiu:
+	registers[instr->rt] = instr->extra << 16;
+	DelayedLoad(0, 0);
+	registers[next->rt] = registers[next->rs] + next->extra;
+	kernel->stats->numFusedLuiAddiu++;
+	break;
+
+      case FuseLwAddu:
+	tmp = registers[instr->rs] + instr->extra;
+	if (tmp & 0x3) {
+	    RaiseException(AddressErrorException, tmp);
+	    return;
+	}
+	if (!ReadMem<FALSE>(tmp, 4, &value)) {
+	    return;
+	}
+	DelayedLoad(instr->rt, value);
+	if (kernelEntries != entries) {		// finish just the lw
+	    registers[PrevPCReg] = pc;
+	    registers[PCReg] = pc + 4;
+	    registers[NextPCReg] = pc + 8;
+	    return;
+	}
+	registers[next->rd] = registers[next->rs] + registers[next->rt];
+	kernel->stats->numFusedLwAddu++;
+	break;
+
+      case FuseSltBne:
+      case FuseSltBeq:
+	registers[instr->rd] = registers[instr->rs] < registers[instr->rt];
+	DelayedLoad(0, 0);
+	if ((registers[next->rs] != registers[next->rt])
+				== (instr->fusion == FuseSltBne)) {
+	    pcAfter = pc + 8 + IndexToAddr(next->extra);
+	}
+	if (instr->fusion == FuseSltBne) {
+	    kernel->stats->numFusedSltBne++;
+	} else {
+	    kernel->stats->numFusedSltBeq++;
+	}
+	break;
+
+      default:
+	ASSERT(FALSE);
+    }
+    DelayedLoad(0, 0);
+    registers[PrevPCReg] = pc + 4;
+    registers[PCReg] = pc + 8;
+    registers[NextPCReg] = pcAfter;
+}
+
+//----------------------------------------------------------------------
+// FuseInstructions
+// 	Return which kind of pair (see FusionType in machine.h), if any, 
+//	"first" and the instruction following it make.  We only fuse 
+//	pairs where the second instruction uses the first one's result,
+//	since that is what the compiler's idioms look like.
+//----------------------------------------------------------------------
+
+static char
+FuseInstructions(Instruction *first, Instruction *second)
+{
+    switch (first->opCode) {
+      case OP_LUI:
+	if (second->rs != first->rt) {
+	    return NotFused;
+	} else if (second->opCode == OP_ORI) {
+	    return FuseLuiOri;
+	} else if (second->opCode == OP_ADDIU) {
+	    return FuseLuiAddiu;
+	}
+	return NotFused;
+
+      case OP_LW:
+	if (second->opCode == OP_ADDU 
+	    && (second->rs == first->rt || second->rt == first->rt)) {
+	    return FuseLwAddu;
+	}
+	return NotFused;
+
+      case OP_SLT:
+	if (second->rs != first->rd && second->rt != first->rd) {
+	    return NotFused;
+	} else if (second->opCode == OP_BNE) {
+	    return FuseSltBne;
+	} else if (second->opCode == OP_BEQ) {
+	    return FuseSltBeq;
+	}
+	return NotFused;
+
+      default:
+	return NotFused;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::BlockLength
+// 	Return the number of instructions in the basic block starting
+//	at physical address "physAddr".  The block includes the delay
+//	slot of a branch or jump, if it is on the same page.
+//
+//	Lengths are remembered per word, and forgotten along with the
+//	decoded instructions when the frame changes.
+//----------------------------------------------------------------------
+
+int
+Machine::BlockLength(int physAddr)
+{
+    int first = physAddr / 4;
+    int last = (physAddr / PageSize + 1) * (PageSize / 4);
+    int i;
+
+    FetchDecoded(physAddr);	// make sure the frame is decoded
+    if (blockLength[first] != 0) {
+	return blockLength[first];
+    }
+    for (i = first; i < last - 1; i++) {
+	switch (decodeCache[i].opCode) {
+	  case OP_BEQ: case OP_BGEZ: case OP_BGEZAL: case OP_BGTZ:
+	  case OP_BLEZ: case OP_BLTZ: case OP_BLTZAL: case OP_BNE:
+	  case OP_J: case OP_JAL: case OP_JALR: case OP_JR:
+	    i++;		// include the delay slot
+	    break;
+	  case OP_SYSCALL: case OP_RES: case OP_UNIMP:
+	    break;
+	  default:
+	    continue;
+	}
+	break;
+    }
+    blockLength[first] = i - first + 1;
+    DEBUG(dbgMach, "Basic block at 0x" << std::hex << physAddr << std::dec
+	  << ", " << (int) blockLength[first] << " instructions");
+    return blockLength[first];
+}
+
+//----------------------------------------------------------------------
+// Machine::FetchDecoded
+// 	Return the decoded form of the instruction stored at physical
+//	address "physAddr".  The first fetch from a frame decodes the
+//	whole frame; after that, fetches from the frame are just an
+//	array lookup, until something writes to the frame (see
+//	WriteMem, TranslationEntry::SwapIn/SwapOut) and invalidates it.
+//	Decoding a frame also marks the pairs of instructions in it that
+//	the block engine can fuse.
+//----------------------------------------------------------------------
+
+Instruction *
+Machine::FetchDecoded(int physAddr)
+{
+    int frame = physAddr / PageSize;
+    Instruction *slot = &decodeCache[frame * (PageSize / 4)];
+
+    if (!frameDecoded[frame]) {
+	unsigned int *word = (unsigned int *) &mainMemory[frame * PageSize];
+
+	DEBUG(dbgMach, "Decoding frame " << frame);
+	for (unsigned int i = 0; i < PageSize / 4; i++) {
+	    slot[i].value = WordToHost(word[i]);
+	    slot[i].Decode();
+	    blockLength[frame * (PageSize / 4) + i] = 0;
+	}
+	for (unsigned int i = 0; i < PageSize / 4 - 1; i++) {
+	    slot[i].fusion = FuseInstructions(&slot[i], &slot[i + 1]);
+	}
+	slot[PageSize / 4 - 1].fusion = NotFused;
+	frameDecoded[frame] = TRUE;
+    }
+    return &decodeCache[physAddr / 4];
+}
+
 //----------------------------------------------------------------------
 // Machine::DelayedLoad
 // 	Simulate effects of a delayed load.
@@ -595,6 +749,153 @@ Machine::DelayedLoad(int nextReg, int nextValue)
     registers[0] = 0; 	// and always make sure R0 stays zero.
 }
 
+//----------------------------------------------------------------------
+// ParallelCpu::Start
+// 	Get ready to run up to "count" instructions of a processor whose
+//	registers are saved in "regs" and whose page table is "table", 
+//	on a host thread (see Machine::RunParallel).  We work on a copy
+//	of the registers, and save a copy of that every "quantum" 
+//	instructions, so that Commit can keep a whole number of turns.
+//----------------------------------------------------------------------
+
+void
+ParallelCpu::Start(int *regs, TranslationEntry *table, unsigned int tableSize,
+		   int count, int quantum)
+{
+    home = regs;
+    pageTable = table;
+    pageTableSize = tableSize;
+    target = count;
+    this->quantum = quantum;
+    done = 0;
+    bcopy(regs, registers, sizeof(registers));
+    saved.resize((count / quantum + 1) * NumTotalRegs);
+    undo.clear();
+    uses.clear();
+}
+
+//----------------------------------------------------------------------
+// ParallelCpu::Run
+// 	Run instructions until we have run the number we were asked to,
+//	or the next one needs the kernel.  Called on a host thread of
+//	its own, so touch nothing the other processors might: just our
+//	own registers, and the frames our own page table maps.
+//----------------------------------------------------------------------
+
+void
+ParallelCpu::Run()
+{
+    bcopy(registers, &saved[0], sizeof(registers));
+    while (done < target && Step()) {
+	done++;
+	if (done % quantum == 0) {
+	    bcopy(registers, &saved[done / quantum * NumTotalRegs],
+		  sizeof(registers));
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// ParallelCpu::Commit
+// 	Keep the first "count" instructions Run ran, as if they had run
+//	on the simulated machine one at a time, and undo the rest.  Called
+//	back on the Nachos thread, after all the host threads are done.
+//
+//	"count" -- Done(), or a multiple of the quantum given to Start
+//----------------------------------------------------------------------
+
+void
+ParallelCpu::Commit(int count)
+{
+    int frame;
+
+    ASSERT(count == done || (count <= done && count % quantum == 0));
+    if (count == done) {
+	bcopy(registers, home, sizeof(registers));
+    } else {
+	bcopy(&saved[count / quantum * NumTotalRegs], home, sizeof(registers));
+    }
+    while (!undo.empty() && undo.back().when >= count) {
+	MemoryUndo *u = &undo.back();
+	
+	bcopy(&u->old, &machine->mainMemory[u->physAddr], u->size);
+	frame = u->physAddr / PageSize;
+	machine->InvalidateFrame(frame);	// in case we fetched from it
+	undo.pop_back();
+    }
+    for (unsigned int i = 0; i < uses.size() && uses[i].when < count; i++) {
+	if (uses[i].writing) {
+	    uses[i].entry->dirty = TRUE;
+	}
+	uses[i].entry->refed = TRUE;
+	uses[i].entry->refCount++;
+    }
+}
+
+//----------------------------------------------------------------------
+// ParallelCpu::Step
+// 	Run the instruction at PC, as Machine::OneInstruction would, 
+//	unless it needs the kernel: then return FALSE, having changed
+//	none of the registers.  What it did to memory, and the pages it
+//	used, are recorded as part of the next instruction, which Commit
+//	never keeps.
+//----------------------------------------------------------------------
+
+bool
+ParallelCpu::Step()
+{
+    const bool traced = FALSE;	// for mipsops.h
+    Instruction *instr;
+    int physAddr;
+    int nextLoadReg = 0;
+    int nextLoadValue = 0;
+    int pcAfter, sum, diff, tmp, value;
+    unsigned int rs, rt, imm;
+
+    if (!Translate(registers[PCReg], &physAddr, 4, FALSE)) {
+	return FALSE;
+    }
+    instr = machine->FetchDecoded(physAddr);
+    pcAfter = registers[NextPCReg] + 4;
+    trapped = FALSE;
+
+    switch (instr->opCode) {
+	
+#define OPCASE(op)	case op
+#define OPDONE		break
+#define OPTRAP		return FALSE
+#include "mipsops.h"
+#undef OPCASE
+#undef OPDONE
+#undef OPTRAP
+
+      default:
+		ASSERT(FALSE);
+    }
+    if (trapped) {		// a system call
+	return FALSE;
+    }
+    DelayedLoad(nextLoadReg, nextLoadValue);
+    registers[PrevPCReg] = registers[PCReg];
+    registers[PCReg] = registers[NextPCReg];
+    registers[NextPCReg] = pcAfter;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ParallelCpu::DelayedLoad
+// 	Same as Machine::DelayedLoad, on our copy of the registers.
+//----------------------------------------------------------------------
+
+void
+ParallelCpu::DelayedLoad(int nextReg, int nextValue)
+{
+    registers[registers[LoadReg]] = registers[LoadValueReg];
+    registers[LoadReg] = nextReg;
+    registers[LoadValueReg] = nextValue;
+    registers[0] = 0;
+}
+
 //----------------------------------------------------------------------
 // Instruction::Decode
 // 	Decode a MIPS instruction 
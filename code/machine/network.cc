@@ -55,22 +55,39 @@ NetworkInput::~NetworkInput()
 //      First check to make sure packet is available & there's space to
 //	pull it in.  Then invoke the "callBack" registered by whoever 
 //	wants the packet.
+//
+//	When replaying (nachos -replay), the packets come from the log
+//	instead, at the times they arrived, and the socket is not read.
 //-----------------------------------------------------------------------
 
 void
 NetworkInput::CallBack()
 {
+    EventLog *log = kernel->eventLog;
+
     // schedule the next time to poll for a packet
     kernel->interrupt->Schedule(this, NetworkTime, NetworkRecvInt);
 
     if (inHdr.length != 0) 	// do nothing if packet is already buffered
 	return;		
-    if (!PollSocket(sock)) 	// do nothing if no packet to be read
-	return;
 
-    // otherwise, read packet in
     char *buffer = new char[MaxWireSize];
-    ReadFromSocket(sock, buffer, MaxWireSize);
+    if (log != NULL && log->Replaying()) {
+	if (!log->Replay(PacketEvent, buffer, MaxWireSize)) {
+	    delete [] buffer;	// do nothing if no packet was logged now
+	    return;
+	}
+    } else {
+	if (!PollSocket(sock)) { // do nothing if no packet to be read
+	    delete [] buffer;
+	    return;
+	}
+	// otherwise, read packet in
+	ReadFromSocket(sock, buffer, MaxWireSize);
+	if (log != NULL) {
+	    log->Record(PacketEvent, buffer, MaxWireSize);
+	}
+    }
 
     // divide packet into header and data
     inHdr = *(PacketHeader *)buffer;
@@ -0,0 +1,209 @@
+// pipeline.cc
+//	Routines to emulate the timing of a pipelined CPU.  See pipeline.h.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "pipeline.h"
+#include "mipssim.h"
+
+// When to bring the cycle counts back down, so they never overflow
+
+static const int MaxCycle = 1 << 30;
+
+// What each opcode reads and writes, in the order of mips.h.  Loads
+// and stores read rs for the address; stores, lwl and lwr read rt too.
+
+#define RsRt	(ReadsRs | ReadsRt)
+
+OpTiming Pipeline::timing[MaxOpcode + 1] = {
+    {0, WritesNone, LatencyOne, FALSE},		// 0: not used
+    {RsRt, WritesRd, LatencyOne, FALSE},	// OP_ADD
+    {ReadsRs, WritesRt, LatencyOne, FALSE},	// OP_ADDI
+    {ReadsRs, WritesRt, LatencyOne, FALSE},	// OP_ADDIU
+    {RsRt, WritesRd, LatencyOne, FALSE},	// OP_ADDU
+    {RsRt, WritesRd, LatencyOne, FALSE},	// OP_AND
+    {ReadsRs, WritesRt, LatencyOne, FALSE},	// OP_ANDI
+    {RsRt, WritesNone, LatencyOne, TRUE},	// OP_BEQ
+    {ReadsRs, WritesNone, LatencyOne, TRUE},	// OP_BGEZ
+    {ReadsRs, WritesR31, LatencyOne, TRUE},	// OP_BGEZAL
+    {ReadsRs, WritesNone, LatencyOne, TRUE},	// OP_BGTZ
+    {ReadsRs, WritesNone, LatencyOne, TRUE},	// OP_BLEZ
+    {ReadsRs, WritesNone, LatencyOne, TRUE},	// OP_BLTZ
+    {ReadsRs, WritesR31, LatencyOne, TRUE},	// OP_BLTZAL
+    {RsRt, WritesNone, LatencyOne, TRUE},	// OP_BNE
+    {0, WritesNone, LatencyOne, FALSE},		// 15: not used
+    {RsRt, WritesHiLo, LatencyDiv, FALSE},	// OP_DIV
+    {RsRt, WritesHiLo, LatencyDiv, FALSE},	// OP_DIVU
+    {0, WritesNone, LatencyOne, TRUE},		// OP_J
+    {0, WritesR31, LatencyOne, TRUE},		// OP_JAL
+    {ReadsRs, WritesRd, LatencyOne, TRUE},	// OP_JALR
+    {ReadsRs, WritesNone, LatencyOne, TRUE},	// OP_JR
+    {ReadsRs, WritesRt, LatencyLoad, FALSE},	// OP_LB
+    {ReadsRs, WritesRt, LatencyLoad, FALSE},	// OP_LBU
+    {ReadsRs, WritesRt, LatencyLoad, FALSE},	// OP_LH
+    {ReadsRs, WritesRt, LatencyLoad, FALSE},	// OP_LHU
+    {0, WritesRt, LatencyOne, FALSE},		// OP_LUI
+    {ReadsRs, WritesRt, LatencyLoad, FALSE},	// OP_LW
+    {RsRt, WritesRt, LatencyLoad, FALSE},	// OP_LWL
+    {RsRt, WritesRt, LatencyLoad, FALSE},	// OP_LWR
+    {0, WritesNone, LatencyOne, FALSE},		// 30: not used
+    {ReadsHiLo, WritesRd, LatencyOne, FALSE},	// OP_MFHI
+    {ReadsHiLo, WritesRd, LatencyOne, FALSE},	// OP_MFLO
+    {0, WritesNone, LatencyOne, FALSE},		// 33: not used
+    {ReadsRs, WritesHiLo, LatencyOne, FALSE},	// OP_MTHI
+    {ReadsRs, WritesHiLo, LatencyOne, FALSE},	// OP_MTLO
+    {RsRt, WritesHiLo, LatencyMult, FALSE},	// OP_MULT
+    {RsRt, WritesHiLo, LatencyMult, FALSE},	// OP_MULTU
+    {RsRt, WritesRd, LatencyOne, FALSE},	// OP_NOR
+    {RsRt, WritesRd, LatencyOne, FALSE},	// OP_OR
+    {ReadsRs, WritesRt, LatencyOne, FALSE},	// OP_ORI
+    {0, WritesNone, LatencyOne, FALSE},		// OP_RFE
+    {RsRt, WritesNone, LatencyOne, FALSE},	// OP_SB
+    {RsRt, WritesNone, LatencyOne, FALSE},	// OP_SH
+    {ReadsRt, WritesRd, LatencyOne, FALSE},	// OP_SLL
+    {RsRt, WritesRd, LatencyOne, FALSE},	// OP_SLLV
+    {RsRt, WritesRd, LatencyOne, FALSE},	// OP_SLT
+    {ReadsRs, WritesRt, LatencyOne, FALSE},	// OP_SLTI
+    {ReadsRs, WritesRt, LatencyOne, FALSE},	// OP_SLTIU
+    {RsRt, WritesRd, LatencyOne, FALSE},	// OP_SLTU
+    {ReadsRt, WritesRd, LatencyOne, FALSE},	// OP_SRA
+    {RsRt, WritesRd, LatencyOne, FALSE},	// OP_SRAV
+    {ReadsRt, WritesRd, LatencyOne, FALSE},	// OP_SRL
+    {RsRt, WritesRd, LatencyOne, FALSE},	// OP_SRLV
+    {RsRt, WritesRd, LatencyOne, FALSE},	// OP_SUB
+    {RsRt, WritesRd, LatencyOne, FALSE},	// OP_SUBU
+    {RsRt, WritesNone, LatencyOne, FALSE},	// OP_SW
+    {RsRt, WritesNone, LatencyOne, FALSE},	// OP_SWL
+    {RsRt, WritesNone, LatencyOne, FALSE},	// OP_SWR
+    {RsRt, WritesRd, LatencyOne, FALSE},	// OP_XOR
+    {ReadsRs, WritesRt, LatencyOne, FALSE},	// OP_XORI
+    {0, WritesNone, LatencyOne, FALSE},		// OP_SYSCALL
+    {0, WritesNone, LatencyOne, FALSE},		// OP_UNIMP
+    {0, WritesNone, LatencyOne, FALSE},		// OP_RES
+};
+
+#undef RsRt
+
+//----------------------------------------------------------------------
+// Pipeline::Pipeline
+// 	Initialize an empty pipeline.
+//
+//	"loadLatency", "multLatency", "divLatency" -- how many cycles
+//		after a load, mult or div starts its result is ready
+//		(1 means the next instruction can use it)
+//	"branchPenalty" -- how many cycles a taken branch loses
+//	"stats" -- where to count the stalls
+//----------------------------------------------------------------------
+
+Pipeline::Pipeline(int loadLatency, int multLatency, int divLatency,
+		   int branchPenalty, PipelineStatistics *stats)
+{
+    latency[LatencyOne] = 1;
+    latency[LatencyLoad] = loadLatency;
+    latency[LatencyMult] = multLatency;
+    latency[LatencyDiv] = divLatency;
+    this->branchPenalty = branchPenalty;
+    this->stats = stats;
+    lastThread = -1;
+    Drain();
+}
+
+//----------------------------------------------------------------------
+// Pipeline::Drain
+// 	Let everything in the pipeline finish: nothing the next
+//	instruction needs will keep it waiting.  Called when the kernel
+//	is entered, and when another thread starts running.
+//----------------------------------------------------------------------
+
+void
+Pipeline::Drain()
+{
+    cycle = 0;
+    for (int i = 0; i < NumGPRegs; i++) {
+	ready[i] = 0;
+    }
+    hiLoReady = 0;
+}
+
+//----------------------------------------------------------------------
+// Pipeline::Account
+// 	Work out when an instruction that has just completed could have
+//	started, given when the values it reads were ready, and note
+//	when its own result will be.  Return the ticks it lost: waiting
+//	for its operands, and, if it is a branch that was taken, the
+//	branch penalty.
+//
+//	A mult or div also waits for the one before it to finish, as
+//	they share HI and LO.
+//
+//	"instr" -- the instruction, decoded
+//	"pc" -- where it was
+//	"nextPC" -- where the instruction after its delay slot is
+//	"thread" -- the id of the thread that ran it
+//----------------------------------------------------------------------
+
+int
+Pipeline::Account(Instruction *instr, int pc, int nextPC, int thread)
+{
+    OpTiming *t = &timing[(int) instr->opCode];
+    int start, operandsAt, lost, reg;
+
+    if (thread != lastThread) {
+	Drain();
+	lastThread = thread;
+    } else if (cycle > MaxCycle) {
+	for (int i = 0; i < NumGPRegs; i++) {
+	    ready[i] = (ready[i] > cycle) ? ready[i] - cycle : 0;
+	}
+	hiLoReady = (hiLoReady > cycle) ? hiLoReady - cycle : 0;
+	cycle = 0;
+    }
+
+    start = cycle;
+    if ((t->reads & ReadsRs) && ready[(int) instr->rs] > start) {
+	start = ready[(int) instr->rs];
+    }
+    if ((t->reads & ReadsRt) && ready[(int) instr->rt] > start) {
+	start = ready[(int) instr->rt];
+    }
+    operandsAt = start;
+    if (((t->reads & ReadsHiLo) || t->writes == WritesHiLo)
+	&& hiLoReady > start) {
+	start = hiLoReady;
+    }
+    stats->loadUseStalls += (operandsAt - cycle) * UserTick;
+    stats->hiLoStalls += (start - operandsAt) * UserTick;
+
+    reg = 0;
+    switch (t->writes) {
+      case WritesRd:
+	reg = instr->rd;
+	break;
+      case WritesRt:
+	reg = instr->rt;
+	break;
+      case WritesR31:
+	reg = 31;
+	break;
+      case WritesHiLo:
+	hiLoReady = start + latency[(int) t->latency];
+	break;
+    }
+    if (reg != 0) {			// r0 is always ready
+	ready[reg] = start + latency[(int) t->latency];
+    }
+
+    lost = start - cycle;
+    cycle = start + 1;
+    if (t->branch && nextPC != pc + 8) {
+	lost += branchPenalty;
+	cycle += branchPenalty;
+	stats->branchStalls += branchPenalty * UserTick;
+    }
+    return lost * UserTick;
+}
@@ -0,0 +1,81 @@
+// pipeline.h
+//	Data structures to emulate the timing of a simple pipelined CPU,
+//	instead of charging UserTick for every user instruction.
+//
+//	The simulator still executes one instruction at a time; the
+//	pipeline only works out how long each one would have held up
+//	the next (nachos -pipeline):
+//
+//	  a load's result can't be used by the next instruction without
+//	  waiting (a load-use interlock);
+//	  mult and div take many cycles to put their result in HI and
+//	  LO, and mfhi, mflo, or another mult or div, must wait for it;
+//	  a branch or jump that is taken throws away the instruction
+//	  fetched after its delay slot.
+//
+//	Each instruction remembers when its result is ready; an
+//	instruction that needs a result that isn't ready yet stalls
+//	until it is.  The stalls are added to the instruction's tick,
+//	so they show up in the user ticks and move the interrupt clock.
+//
+//	Entering the kernel, or switching threads, drains the pipeline:
+//	the kernel takes long enough that everything is ready after it.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "stats.h"
+#include "machine.h"
+
+// What an instruction reads and writes, and how long its result takes
+
+enum { ReadsRs = 1, ReadsRt = 2, ReadsHiLo = 4 };
+enum { WritesNone, WritesRd, WritesRt, WritesR31, WritesHiLo };
+enum { LatencyOne, LatencyLoad, LatencyMult, LatencyDiv };
+
+class OpTiming {
+  public:
+    char reads;			// ReadsRs | ReadsRt | ReadsHiLo
+    char writes;		// WritesRd, WritesRt, WritesR31 or
+				// WritesHiLo, if any
+    char latency;		// LatencyOne, LatencyLoad, ...
+    bool branch;		// TRUE for branches and jumps
+};
+
+// The following class defines the pipeline of the simulated CPU.
+
+class Pipeline {
+  public:
+    Pipeline(int loadLatency, int multLatency, int divLatency,
+	     int branchPenalty, PipelineStatistics *stats);
+				// Set the latencies, in cycles (ticks)
+    ~Pipeline() {}
+
+    int Account(Instruction *instr, int pc, int nextPC, int thread);
+				// The instruction "instr" at "pc", run by
+				// "thread", has completed, and the one
+				// after its delay slot is at "nextPC";
+				// return the ticks it stalled for
+    void Drain();		// Everything in progress is done
+
+  private:
+    static OpTiming timing[];	// for each opcode; see mips.h
+    int latency[4];		// cycles for LatencyOne, LatencyLoad, ...
+    int branchPenalty;		// cycles lost to a taken branch
+    PipelineStatistics *stats;	// where to count the stalls
+
+    int cycle;			// when the next instruction can start,
+    int ready[NumGPRegs];	// when each register's value is ready,
+    int hiLoReady;		//   and HI and LO
+    int lastThread;		// the thread of the last instruction
+};
+
+#endif // PIPELINE_H
@@ -19,9 +19,33 @@
 Statistics::Statistics() {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     schdulerTicks = 100;
+    numUserInstructions = 0;
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numFusedLuiOri = numFusedLuiAddiu = numFusedLwAddu = 0;
+    numFusedSltBne = numFusedSltBeq = 0;
+    iCache.hits = iCache.misses = iCache.writebacks = iCache.stallTicks = 0;
+    dCache.hits = dCache.misses = dCache.writebacks = dCache.stallTicks = 0;
+    pipeline.loadUseStalls = pipeline.hiLoStalls = pipeline.branchStalls = 0;
+    tlb.hits = tlb.misses = 0;
+}
+
+//----------------------------------------------------------------------
+// PrintCache
+// 	Print the statistics for one cache, if it was used.
+//----------------------------------------------------------------------
+
+static void
+PrintCache(const char *name, CacheStatistics *cache)
+{
+    if (cache->hits + cache->misses > 0) {
+	cout << name << ": hits " << cache->hits;
+	cout << ", misses " << cache->misses;
+	cout << " (" << 100.0 * cache->misses / (cache->hits + cache->misses)
+	     << "%), write-backs " << cache->writebacks;
+	cout << ", stall ticks " << cache->stallTicks << "\n";
+    }
 }
 
 //----------------------------------------------------------------------
@@ -34,6 +58,9 @@ void
 Statistics::Print() {
     cout << "Ticks: total " << totalTicks << ", idle " << idleTicks;
 		cout << ", system " << systemTicks << ", user " << userTicks <<"\n";
+    if (numUserInstructions > 0) {
+    cout << "User instructions: " << numUserInstructions << "\n";
+    }
     cout << "Disk I/O: reads " << numDiskReads;
 		cout << ", writes " << numDiskWrites << "\n";
 		cout << "Console I/O: reads " << numConsoleCharsRead;
@@ -41,4 +68,25 @@ Statistics::Print() {
     cout << "Paging: faults " << numPageFaults << "\n";
     cout << "Network I/O: packets received " << numPacketsRecvd;
 		cout << ", sent " << numPacketsSent << "\n";
+    if (numFusedLuiOri + numFusedLuiAddiu + numFusedLwAddu
+			+ numFusedSltBne + numFusedSltBeq > 0) {
+    cout << "Fused pairs: lui+ori " << numFusedLuiOri;
+		cout << ", lui+addiu " << numFusedLuiAddiu;
+		cout << ", lw+addu " << numFusedLwAddu;
+		cout << ", slt+bne " << numFusedSltBne;
+		cout << ", slt+beq " << numFusedSltBeq << "\n";
+    }
+    PrintCache("I-cache", &iCache);
+    PrintCache("D-cache", &dCache);
+    if (tlb.hits + tlb.misses > 0) {
+    cout << "TLB: hits " << tlb.hits;
+		cout << " (" << 100.0 * tlb.hits / (tlb.hits + tlb.misses)
+		     << "%), misses " << tlb.misses << "\n";
+    }
+    if (pipeline.loadUseStalls + pipeline.hiLoStalls 
+			+ pipeline.branchStalls > 0) {
+    cout << "Pipeline stall ticks: load-use " << pipeline.loadUseStalls;
+		cout << ", HI/LO " << pipeline.hiLoStalls;
+		cout << ", taken branches " << pipeline.branchStalls << "\n";
+    }
 }
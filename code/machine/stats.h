@@ -12,30 +12,70 @@
 #define STATS_H
 
 #include "copyright.h"
+#include "utility.h"
+
+// What each simulated cache counts (see cache.h)
+
+class CacheStatistics {
+  public:
+    long long hits;
+    long long misses;
+    long long writebacks;	// dirty lines thrown out
+    Ticks stallTicks;		// user time spent on hits, misses and
+				// write-backs
+};
+
+// What the TLB counts (see tlb.h)
+
+class TLBStatistics {
+  public:
+    long long hits;
+    long long misses;		// each one a trap to the kernel
+};
+
+// What the pipeline timing model counts (see pipeline.h)
+
+class PipelineStatistics {
+  public:
+    Ticks loadUseStalls;	// ticks waiting for a load's result,
+    Ticks hiLoStalls;		//   for a mult or div's, and lost to
+    Ticks branchStalls;		//   taken branches and jumps
+};
 
 // The following class defines the statistics that are to be kept
 // about Nachos behavior -- how much time (ticks) elapsed, how
 // many user instructions executed, etc.
 //
 // The fields in this class are public to make it easier to update.
+// The times and counts are all 64 bits (see Ticks, in utility.h).
 
 class Statistics {
   public:
-    int totalTicks;      	// Total time running Nachos
-    int idleTicks;       	// Time spent idle (no threads to run)
-    int systemTicks;	 	// Time spent executing system code
-    int userTicks;       	// Time spent executing user code
+    Ticks totalTicks;      	// Total time running Nachos
+    Ticks idleTicks;       	// Time spent idle (no threads to run)
+    Ticks systemTicks;	 	// Time spent executing system code
+    Ticks userTicks;       	// Time spent executing user code
     int schdulerTicks;     // schduler timer tick time
 				// (this is also equal to # of
 				// user instructions executed)
 
-    int numDiskReads;		// number of disk read requests
-    int numDiskWrites;		// number of disk write requests
-    int numConsoleCharsRead;	// number of characters read from the keyboard
-    int numConsoleCharsWritten; // number of characters written to the display
-    int numPageFaults;		// number of virtual memory page faults
-    int numPacketsSent;		// number of packets sent over the network
-    int numPacketsRecvd;	// number of packets received over the network
+    long long numUserInstructions;	// number of user instructions completed
+    long long numDiskReads;	// number of disk read requests
+    long long numDiskWrites;	// number of disk write requests
+    long long numConsoleCharsRead;	// number of characters read from the keyboard
+    long long numConsoleCharsWritten; // number of characters written to the display
+    long long numPageFaults;	// number of virtual memory page faults
+    long long numPacketsSent;	// number of packets sent over the network
+    long long numPacketsRecvd;	// number of packets received over the network
+    long long numFusedLuiOri;	// number of instruction pairs of each kind
+    long long numFusedLuiAddiu;	// executed as one (see Machine::ExecuteFused)
+    long long numFusedLwAddu;
+    long long numFusedSltBne;
+    long long numFusedSltBeq;
+    CacheStatistics iCache;	// for the instruction cache, and the
+    CacheStatistics dCache;	// data cache, if any (nachos -icache ...)
+    PipelineStatistics pipeline;// for the pipeline (nachos -pipeline)
+    TLBStatistics tlb;		// for the TLB, if any (nachos -tlb)
 
     Statistics(); 		// initialize everything to zero
 
@@ -57,5 +97,11 @@ const int SeekTime =	 500;  	// time disk takes to seek past one track
 const int ConsoleTime =	 100;	// time to read or write one character
 const int NetworkTime =	 100;  	// time to send or receive one packet
 const int TimerTicks = 	 100;  	// (average) time between timer interrupts
+const int CacheHitTime =   0;	// extra time for a cache hit, by default
+const int CacheMissTime = 10;	//   for a cache miss, or a write-back
+const int LoadLatency =    2;	// cycles until a load's result can be 
+const int MultLatency =   12;	//   used, a mult's, a div's, by default
+const int DivLatency =    35;	//   (as on an R3000)
+const int BranchPenalty =  1;	// cycles lost to a taken branch
 
 #endif // STATS_H
@@ -9,6 +9,9 @@
 //
 //      In order to introduce some randomness into time-slicing, if "doRandom"
 //      is set, then the interrupt is comes after a random number of ticks.
+//	The random delays are recorded with -record, and taken from the
+//	log with -replay (see eventlog.h).  A replayed delay still uses
+//	up a random number, as it did when it was recorded.
 //
 //	Remember -- nothing in here is part of Nachos.  It is just
 //	an emulation for the hardware that Nachos is running on top of.
@@ -54,24 +57,63 @@ Timer::CallBack() {
     callPeriodically->CallBack();
     
     SetInterrupt();	// do last, to let software interrupt handler
-    			// decide if it wants to disable future interrupts
+    			// decide if it wants to disable future interrupts,
+			// or to Reprogram the next one
 }
 
 //----------------------------------------------------------------------
 // Timer::SetInterrupt
 //      Cause a timer interrupt to occur in the future, unless
 //	future interrupts have been disabled.  The delay is either
-//	fixed or random.
+//	fixed or random; when replaying, it is whatever the run being
+//	replayed used.
 //----------------------------------------------------------------------
 
 void Timer::SetInterrupt() {
-    if (!disable) {
+    if (!disable && !kernel->interrupt->IsPending(next)) {
         int delay = kernel->stats->schdulerTicks;
+        EventLog *log = kernel->eventLog;
     
-        if (randomize) {
+        if (log != NULL && log->Replaying()) {
+	        if (log->Replay(TimerEvent, &delay, sizeof(delay))) {
+		    (void) RandomNumber();	// drawn for it when recorded;
+					// keeps the caches and the TLB
+					// drawing what they drew then
+	        }
+        } else if (randomize) {
 	        delay = 1 + (RandomNumber() % (kernel->stats->schdulerTicks * 2));
+	        if (log != NULL) {
+		    log->Record(TimerEvent, &delay, sizeof(delay));
+	        }
         }
         // schedule the next timer device interrupt
-        kernel->interrupt->Schedule(this, delay, TimerInt);
+        next = kernel->interrupt->Schedule(this, delay, TimerInt);
+    }
+}
+
+//----------------------------------------------------------------------
+// Timer::Disable
+//      Turn the timer off: cancel the interrupt it has scheduled, if
+//	any, and don't schedule another.
+//----------------------------------------------------------------------
+
+void
+Timer::Disable() {
+    disable = TRUE;
+    kernel->interrupt->Cancel(next);
+}
+
+//----------------------------------------------------------------------
+// Timer::Reprogram
+//      Make the next interrupt come "fromNow" ticks from now, instead
+//	of when it was due: move the one scheduled, or schedule one if
+//	there isn't one.  Turns the timer back on, if it was off.
+//----------------------------------------------------------------------
+
+void
+Timer::Reprogram(int fromNow) {
+    disable = FALSE;
+    if (!kernel->interrupt->Reschedule(next, fromNow)) {
+	next = kernel->interrupt->Schedule(this, fromNow, TimerInt);
     }
 }
@@ -23,6 +23,7 @@
 #include "copyright.h"
 #include "utility.h"
 #include "callback.h"
+#include "interrupt.h"
 
 // The following class defines a hardware timer. 
 class Timer : public CallBackObj {
@@ -32,15 +33,19 @@ class Timer : public CallBackObj {
 				// every time slice.
     virtual ~Timer() {}
     
-    void Disable() { disable = TRUE; }
-    				// Turn timer device off, so it doesn't
+    void Disable();		// Turn timer device off, so it doesn't
 				// generate any more interrupts.
+    void Reprogram(int fromNow);
+				// Interrupt "fromNow" ticks from now,
+				// instead of when it would have, and
+				// every time slice from then on
 
   private:
     bool randomize;		// set if we need to use a random timeout delay
     CallBackObj *callPeriodically; // call this every TimerTicks time units 
     bool disable;		// turn off the timer device after next
     				// interrupt.
+    InterruptHandle next;	// the interrupt scheduled, if any
     
     void CallBack();		// called internally when the hardware
 				// timer generates an interrupt
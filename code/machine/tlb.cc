@@ -0,0 +1,190 @@
+// tlb.cc
+//	Routines to emulate a software-loaded TLB.  See tlb.h.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "tlb.h"
+#include "debug.h"
+#include "sysdep.h"
+
+//----------------------------------------------------------------------
+// TLB::TLB
+// 	Initialize an empty TLB.
+//
+//	"sets" -- the number of sets
+//	"ways" -- the associativity: the number of entries in a set
+//	"policy" -- which entry of a set a refill replaces
+//	"counts" -- where to count hits and misses
+//----------------------------------------------------------------------
+
+TLB::TLB(int sets, int ways, ReplacementPolicy policy, TLBStatistics *counts)
+{
+    ASSERT(sets > 0 && ways > 0);
+    numSets = sets;
+    assoc = ways;
+    replace = policy;
+    stats = counts;
+    currentAsid = 0;
+    now = 0;
+    slots = new TLBSlot[numSets * assoc];
+    for (int i = 0; i < numSets * assoc; i++) {
+	slots[i].entry.valid = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// TLB::~TLB
+//----------------------------------------------------------------------
+
+TLB::~TLB()
+{
+    delete [] slots;
+}
+
+//----------------------------------------------------------------------
+// TLB::Lookup
+// 	Return the translation of virtual page "vpn" of the current
+//	address space, or NULL if the kernel hasn't loaded it.  The
+//	caller sets its use and dirty bits.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+TLB::Lookup(unsigned int vpn)
+{
+    TLBSlot *set = &slots[(vpn % numSets) * assoc];
+
+    now++;
+    for (int i = 0; i < assoc; i++) {
+	if (set[i].entry.valid && set[i].asid == currentAsid
+	    && set[i].entry.virtualPage == vpn) {
+	    if (replace == LRUReplace) {
+		set[i].lastUse = now;
+	    }
+	    stats->hits++;
+	    return &set[i].entry;
+	}
+    }
+    stats->misses++;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// TLB::SetAsid
+// 	Translate for address space "asid" from now on.  The entries of
+//	the others stay, for when they run again.
+//----------------------------------------------------------------------
+
+void
+TLB::SetAsid(int asid)
+{
+    ASSERT(asid >= 0 && asid < NumAsids);
+    currentAsid = asid;
+}
+
+//----------------------------------------------------------------------
+// TLB::Load
+// 	Load the translation in page table entry "pte" for the current
+//	address space: into an empty entry of its set if there is one,
+//	or else in place of the one the replacement policy picks, whose
+//	use and dirty bits are copied back first.
+//----------------------------------------------------------------------
+
+void
+TLB::Load(TranslationEntry *pte)
+{
+    TLBSlot *set = &slots[(pte->virtualPage % numSets) * assoc];
+    TLBSlot *victim = NULL;
+
+    ASSERT(pte->valid);
+    for (int i = 0; i < assoc && victim == NULL; i++) {
+	if (!set[i].entry.valid) {
+	    victim = &set[i];
+	}
+    }
+    if (victim == NULL) {
+	if (replace == RandomReplace) {
+	    victim = &set[RandomNumber() % assoc];
+	} else {		// the oldest, by use or by arrival
+	    victim = &set[0];
+	    for (int i = 1; i < assoc; i++) {
+		if (set[i].lastUse < victim->lastUse) {
+		    victim = &set[i];
+		}
+	    }
+	}
+	WriteBack(victim);
+    }
+    DEBUG(dbgAddr, "TLB load of page " << pte->virtualPage << ", ASID " << currentAsid);
+    victim->entry = *pte;
+    victim->asid = currentAsid;
+    victim->pte = pte;
+    victim->lastUse = now;
+}
+
+//----------------------------------------------------------------------
+// TLB::WriteBack
+// 	Copy the use and dirty bits, and the use count, of one entry, or
+//	of every entry, back to the page table entries they were loaded
+//	from.  The page table entries can't have changed meanwhile:
+//	the kernel invalidates the TLB entry first.
+//----------------------------------------------------------------------
+
+void
+TLB::WriteBack(TLBSlot *slot)
+{
+    if (slot->entry.valid) {
+	slot->pte->refed = slot->entry.refed;
+	slot->pte->dirty = slot->entry.dirty;
+	slot->pte->refCount = slot->entry.refCount;
+    }
+}
+
+void
+TLB::WriteBack()
+{
+    for (int i = 0; i < numSets * assoc; i++) {
+	WriteBack(&slots[i]);
+    }
+}
+
+//----------------------------------------------------------------------
+// TLB::Invalidate
+// 	Forget the translation loaded from "pte", if there is one: the
+//	kernel is about to change it.
+//----------------------------------------------------------------------
+
+void
+TLB::Invalidate(TranslationEntry *pte)
+{
+    TLBSlot *set = &slots[(pte->virtualPage % numSets) * assoc];
+
+    for (int i = 0; i < assoc; i++) {
+	if (set[i].entry.valid && set[i].pte == pte) {
+	    WriteBack(&set[i]);
+	    set[i].entry.valid = FALSE;
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// TLB::FlushAsid
+// 	Forget all the translations of address space "asid", because it
+//	is going away, or its ASID is being given to another.
+//----------------------------------------------------------------------
+
+void
+TLB::FlushAsid(int asid)
+{
+    for (int i = 0; i < numSets * assoc; i++) {
+	if (slots[i].entry.valid && slots[i].asid == asid) {
+	    WriteBack(&slots[i]);
+	    slots[i].entry.valid = FALSE;
+	}
+    }
+}
+
@@ -0,0 +1,85 @@
+// tlb.h
+//	Data structures to emulate a software-loaded, set-associative
+//	translation lookaside buffer.
+//
+//	When the machine has a TLB (a USE_TLB build, or nachos -tlb), the
+//	CPU translates through it alone: a virtual page that isn't in it
+//	raises a PageFaultException, and the kernel loads the translation
+//	from the page table of the running address space (see
+//	AddrSpace::RefillTLB).  The kernel is free to keep whatever page
+//	tables it likes; the CPU never looks at them.
+//
+//	As on the MIPS R2000, each entry is tagged with the address space
+//	id (ASID) it was loaded for, and only entries of the current ASID
+//	match; so switching address spaces need not flush the TLB.
+//
+//	Each entry also remembers which page table entry it was loaded
+//	from, as the kernel's refill handler would, so that the use and
+//	dirty bits the CPU sets in the TLB can be copied back to it.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TLB_EMUL_H
+#define TLB_EMUL_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "translate.h"
+#include "cache.h"
+#include "stats.h"
+
+const int NumAsids = 64;		// the R2000's 6-bit ASIDs
+
+// One entry of the TLB
+
+class TLBSlot {
+  public:
+    TranslationEntry entry;	// the translation, as the CPU uses it
+    int asid;			// the address space it belongs to
+    TranslationEntry *pte;	// the page table entry it was loaded from
+    unsigned long long lastUse;	// when it was last used (for LRU) or
+				// loaded (for FIFO)
+};
+
+// The following class defines a TLB.
+
+class TLB {
+  public:
+    TLB(int sets, int ways, ReplacementPolicy policy, TLBStatistics *counts);
+				// Initialize an empty TLB of "sets" sets
+				// of "ways" entries each; count hits and
+				// misses in "counts"
+    ~TLB();
+
+    TranslationEntry *Lookup(unsigned int vpn);
+				// The translation of virtual page "vpn" of
+				// the current address space, or NULL
+
+    void SetAsid(int asid);	// Switch to another address space
+    void Load(TranslationEntry *pte);
+				// Load a translation of the current
+				// address space, replacing another if
+				// need be
+    void Invalidate(TranslationEntry *pte);
+				// Forget any translation loaded from "pte"
+    void FlushAsid(int asid);	// Forget all of an address space
+    void WriteBack();		// Copy the use and dirty bits back to
+				// the page tables
+
+  private:
+    void WriteBack(TLBSlot *slot);
+
+    int numSets;
+    int assoc;			// # of entries per set
+    ReplacementPolicy replace;
+    TLBSlot *slots;		// numSets * assoc of them, a set at a time
+    int currentAsid;
+    unsigned long long now;	// # of lookups so far
+    TLBStatistics *stats;
+};
+
+#endif // TLB_EMUL_H
@@ -0,0 +1,122 @@
+// tracewriter.cc
+//	Routines to record a memory reference trace.  See tracewriter.h.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "tracewriter.h"
+#include "debug.h"
+#include "sysdep.h"
+
+//----------------------------------------------------------------------
+// MemTraceWriter::MemTraceWriter
+// 	Create the trace file "fileName", write its header, and start
+//	the writer thread.
+//----------------------------------------------------------------------
+
+MemTraceWriter::MemTraceWriter(char *fileName)
+{
+    fd = OpenForWrite(fileName);
+    WriteFile(fd, (char *) MemTraceMagic, 4);
+    block = new unsigned char[MemTraceBlockSize];
+    used = 0;
+    stopping = FALSE;
+    writer = std::thread(&MemTraceWriter::WriteBlocks, this);
+}
+
+//----------------------------------------------------------------------
+// MemTraceWriter::~MemTraceWriter
+// 	Hand over the last block, wait for the writer thread to write
+//	everything out, and close the file.
+//----------------------------------------------------------------------
+
+MemTraceWriter::~MemTraceWriter()
+{
+    if (used > 0) {
+	Flush();
+    }
+    {
+	std::lock_guard<std::mutex> guard(lock);
+	stopping = TRUE;
+    }
+    queued.notify_one();
+    writer.join();
+    delete [] block;
+    Close(fd);
+}
+
+//----------------------------------------------------------------------
+// MemTraceWriter::Flush
+// 	Queue the block we have filled for the writer thread, waiting
+//	first if it is too far behind, and start a new block.
+//----------------------------------------------------------------------
+
+void
+MemTraceWriter::Flush()
+{
+    TraceBlock full;
+
+    full.data = block;
+    full.size = used;
+    {
+	std::unique_lock<std::mutex> guard(lock);
+	while (queue.size() >= (unsigned) MaxTraceBlocksQueued) {
+	    written.wait(guard);
+	}
+	queue.push_back(full);
+    }
+    queued.notify_one();
+    block = new unsigned char[MemTraceBlockSize];
+    used = 0;
+    codec.Reset();
+}
+
+//----------------------------------------------------------------------
+// MemTraceWriter::WriteBlocks
+// 	The body of the writer thread: compress each block queued, in
+//	order, and write it to the file.  Blocks that don't get smaller
+//	are written as they are.
+//----------------------------------------------------------------------
+
+void
+MemTraceWriter::WriteBlocks()
+{
+    unsigned char *packed = new unsigned char[MemTraceMaxPacked];
+    unsigned char sizes[8];
+    TraceBlock next;
+    int size;
+
+    for (;;) {
+	{
+	    std::unique_lock<std::mutex> guard(lock);
+	    while (queue.empty() && !stopping) {
+		queued.wait(guard);
+	    }
+	    if (queue.empty()) {
+		break;			// stopping, and all written
+	    }
+	    next = queue.front();
+	}
+	size = MemTraceCompress(next.data, next.size, packed);
+	if (size >= next.size) {
+	    size = next.size;
+	}
+	for (int i = 0; i < 4; i++) {
+	    sizes[i] = (next.size >> (8 * i)) & 0xff;
+	    sizes[4 + i] = (size >> (8 * i)) & 0xff;
+	}
+	WriteFile(fd, (char *) sizes, 8);
+	WriteFile(fd, (char *) (size == next.size ? next.data : packed), size);
+	delete [] next.data;
+	{
+	    std::lock_guard<std::mutex> guard(lock);
+	    queue.pop_front();
+	}
+	written.notify_one();
+    }
+    delete [] packed;
+}
@@ -0,0 +1,80 @@
+// tracewriter.h
+//	Data structures to record the memory references of user programs
+//	in a trace file (nachos -memtrace).  See memtrace.h for what is
+//	recorded, and the format.
+//
+//	The simulator only encodes each reference into the block being
+//	filled, which is cheap; when the block is full, a host thread of
+//	its own compresses it and writes it out, while the simulation
+//	goes on with the next one.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TRACEWRITER_H
+#define TRACEWRITER_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "memtrace.h"
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+const int MaxTraceBlocksQueued = 8;	// how far the simulation may get
+					// ahead of the writer thread
+
+// A block of records, on its way to the writer thread
+
+class TraceBlock {
+  public:
+    unsigned char *data;
+    int size;
+};
+
+// The following class defines a trace being recorded.
+
+class MemTraceWriter {
+  public:
+    MemTraceWriter(char *fileName);
+				// Create the trace file, and start the
+				// writer thread
+    ~MemTraceWriter();		// Write out what's left, and close it
+
+    void Record(MemTraceKind kind, int thread, int virtAddr, int frame) {
+	MemTraceRecord rec;
+
+	if (used > MemTraceBlockSize - MemTraceMaxRecord) {
+	    Flush();
+	}
+	rec.kind = kind;
+	rec.thread = thread;
+	rec.virtAddr = virtAddr;
+	rec.frame = frame;
+	used += codec.Encode(&rec, block + used);
+    }				// Add a reference to the trace
+
+  private:
+    void Flush();		// Hand the block to the writer thread,
+				// and start a new one
+    void WriteBlocks();		// The writer thread: compress and write
+				// blocks until told to stop
+
+    int fd;			// the trace file
+    unsigned char *block;	// the block being filled
+    int used;			// # of bytes of it filled
+    MemTraceCodec codec;
+
+    std::deque<TraceBlock> queue;	// blocks for the writer thread,
+    bool stopping;			// and whether there will be more
+    std::mutex lock;			// protects "queue" and "stopping"
+    std::condition_variable queued;	// signalled when either changes,
+    std::condition_variable written;	// and when a block is written
+    std::thread writer;
+};
+
+#endif // TRACEWRITER_H
@@ -33,6 +33,9 @@
 #include "main.h"
 #include "translate.h"
 #include "machine.h"
+#include "cache.h"
+#include "tracewriter.h"
+#include "tlb.h"
 
 // Routines for converting Words and Short Words to and from the
 // simulated machine's format of little endian.  These end up
@@ -88,31 +91,51 @@ ShortToMachine(unsigned short shortword) { return ShortToHost(shortword); }
 //	"value" -- the place to write the result
 //----------------------------------------------------------------------
 
+template <bool traced>
 bool Machine::ReadMem(int addr, int size, int *value) {
     int data;
     ExceptionType exception;
     int physicalAddress;
+    TranslationEntry *entry;
+    HostTLBEntry *hit;
+    char *where;
     
-    DEBUG(dbgAddr, "Writing VA 0x" << std::hex << addr << ", size 0x" << size << std::dec);
+    TRACE(dbgAddr, "Writing VA 0x" << std::hex << addr << ", size 0x" << size << std::dec);
     
-    exception = Translate(addr, &physicalAddress, size, FALSE);
-    if (exception != NoException) {
-        RaiseException(exception, addr);
-        return FALSE;
+    hit = traced ? NULL : LookupHostTLB(addr, size, FALSE);
+    if (hit != NULL) {
+        where = hit->page + (unsigned) addr % PageSize;
+    } else {
+        exception = Translate<traced>(addr, &physicalAddress, size, FALSE, &entry);
+        if (exception != NoException) {
+            RaiseException(exception, addr);
+            return FALSE;
+        }
+        if (!traced) {
+            FillHostTLB(addr, entry);
+        }
+        where = &mainMemory[physicalAddress];
+    }
+    if (dcache != NULL) {
+        pendingTicks += dcache->Access(where - mainMemory, FALSE);
+    }
+    if (memTrace != NULL) {
+        memTrace->Record(TraceLoad, kernel->currentThread->getId(), addr,
+                         (where - mainMemory) / PageSize);
     }
     switch (size) {
       case 1:
-        data = mainMemory[physicalAddress];
+        data = *where;
         *value = data;
         break;
 	
       case 2:
-        data = *(unsigned short *) &mainMemory[physicalAddress];
+        data = *(unsigned short *) where;
         *value = ShortToHost(data);
         break;
 	
       case 4:
-        data = *(unsigned int *) &mainMemory[physicalAddress];
+        data = *(unsigned int *) where;
         *value = WordToHost(data);
         break;
 
@@ -120,7 +143,7 @@ bool Machine::ReadMem(int addr, int size, int *value) {
         ASSERT(FALSE);
     }
     
-    DEBUG(dbgAddr, "\tvalue read = 0x" << std::hex  << *value << std::dec);
+    TRACE(dbgAddr, "\tvalue read = 0x" << std::hex  << *value << std::dec);
     return (TRUE);
 }
 
@@ -137,29 +160,50 @@ bool Machine::ReadMem(int addr, int size, int *value) {
 //	"value" -- the data to be written
 //----------------------------------------------------------------------
 
+template <bool traced>
 bool Machine::WriteMem(int addr, int size, int value) {
     ExceptionType exception;
     int physicalAddress;
+    TranslationEntry *entry;
+    HostTLBEntry *hit;
+    char *where;
 
-    DEBUG(dbgAddr, "Writing VA 0x" << std::hex << addr << ", size 0x" << size << ", value 0x" << value << std::dec);
+    TRACE(dbgAddr, "Writing VA 0x" << std::hex << addr << ", size 0x" << size << ", value 0x" << value << std::dec);
 
-    exception = Translate(addr, &physicalAddress, size, TRUE);
-    if (exception != NoException) {
-        RaiseException(exception, addr);
-        return FALSE;
+    hit = traced ? NULL : LookupHostTLB(addr, size, TRUE);
+    if (hit != NULL) {
+        where = hit->page + (unsigned) addr % PageSize;
+    } else {
+        exception = Translate<traced>(addr, &physicalAddress, size, TRUE, &entry);
+        if (exception != NoException) {
+            RaiseException(exception, addr);
+            return FALSE;
+        }
+        if (!traced) {
+            FillHostTLB(addr, entry);
+        }
+        where = &mainMemory[physicalAddress];
+    }
+    if (dcache != NULL) {
+        pendingTicks += dcache->Access(where - mainMemory, TRUE);
     }
+    if (memTrace != NULL) {
+        memTrace->Record(TraceStore, kernel->currentThread->getId(), addr,
+                         (where - mainMemory) / PageSize);
+    }
+    InvalidateFrame((where - mainMemory) / PageSize);	// self-modifying code
     switch (size) {
       case 1:
-        mainMemory[physicalAddress] = (unsigned char) (value & 0xff);
+        *where = (unsigned char) (value & 0xff);
         break;
 
       case 2:
-        *(unsigned short *) &mainMemory[physicalAddress]
+        *(unsigned short *) where
             = ShortToMachine((unsigned short) (value & 0xffff));
     	break;
       
       case 4:
-        *(unsigned int *) &mainMemory[physicalAddress]
+        *(unsigned int *) where
             = WordToMachine((unsigned int) value);
         break;
 	
@@ -170,6 +214,189 @@ bool Machine::WriteMem(int addr, int size, int value) {
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// Machine::CopyIn
+//      Copy "size" bytes of virtual memory, starting at "virtAddr", into
+//	the kernel buffer "buffer".  For system calls that take a pointer
+//	into the user program: we translate once per page, and copy each
+//	page's part in one go, instead of calling ReadMem for every byte.
+//
+//   	Returns FALSE if some page could not be translated; the exception
+//	has been raised, as for ReadMem, and "buffer" is only partly 
+//	filled in.
+//
+//	"virtAddr" -- the virtual address to read from
+//	"size" -- the number of bytes to copy
+//	"buffer" -- the place to put them
+//----------------------------------------------------------------------
+
+bool Machine::CopyIn(int virtAddr, int size, char *buffer) {
+    ExceptionType exception;
+    int physicalAddress, chunk;
+
+    DEBUG(dbgAddr, "Copying in VA 0x" << std::hex << virtAddr << ", size 0x" << size << std::dec);
+
+    while (size > 0) {
+        exception = TranslateAny(virtAddr, &physicalAddress, FALSE);
+        if (exception != NoException) {
+            RaiseException(exception, virtAddr);
+            return FALSE;
+        }
+        chunk = min(size, (int) (PageSize - (unsigned) virtAddr % PageSize));
+        bcopy(&mainMemory[physicalAddress], buffer, chunk);
+        virtAddr += chunk;
+        buffer += chunk;
+        size -= chunk;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::CopyOut
+//      Copy "size" bytes from the kernel buffer "buffer" into virtual
+//	memory, starting at "virtAddr", a page at a time (see CopyIn).
+//
+//   	Returns FALSE if some page could not be translated, or is 
+//	read-only; the exception has been raised, as for WriteMem, and
+//	only the pages before it have been written.
+//
+//	"virtAddr" -- the virtual address to write to
+//	"size" -- the number of bytes to copy
+//	"buffer" -- the data to be written
+//----------------------------------------------------------------------
+
+bool Machine::CopyOut(int virtAddr, int size, char *buffer) {
+    ExceptionType exception;
+    int physicalAddress, chunk;
+
+    DEBUG(dbgAddr, "Copying out VA 0x" << std::hex << virtAddr << ", size 0x" << size << std::dec);
+
+    while (size > 0) {
+        exception = TranslateAny(virtAddr, &physicalAddress, TRUE);
+        if (exception != NoException) {
+            RaiseException(exception, virtAddr);
+            return FALSE;
+        }
+        chunk = min(size, (int) (PageSize - (unsigned) virtAddr % PageSize));
+        InvalidateFrame(physicalAddress / PageSize);
+        bcopy(buffer, &mainMemory[physicalAddress], chunk);
+        virtAddr += chunk;
+        buffer += chunk;
+        size -= chunk;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::CopyStringIn
+//      Copy the null-terminated string at "virtAddr" into the kernel
+//	buffer "buffer", a page at a time (see CopyIn).  At most size-1
+//	characters are copied, and the result is always null-terminated;
+//	if the return value is size-1, the caller can't tell whether the
+//	string was cut short, and should ask for the rest.
+//
+//   	Returns the length of the string copied, or -1 if some page 
+//	could not be translated (the exception has been raised); "buffer"
+//	then holds, null-terminated, what was copied before that page.
+//
+//	"virtAddr" -- the virtual address of the string
+//	"buffer" -- the place to put it
+//	"size" -- the size of "buffer"
+//----------------------------------------------------------------------
+
+int Machine::CopyStringIn(int virtAddr, char *buffer, int size) {
+    ExceptionType exception;
+    int physicalAddress, chunk, length = 0;
+    char *from;
+
+    DEBUG(dbgAddr, "Copying in string at VA 0x" << std::hex << virtAddr << std::dec);
+
+    ASSERT(size > 0);
+    while (length < size - 1) {
+        exception = TranslateAny(virtAddr, &physicalAddress, FALSE);
+        if (exception != NoException) {
+            RaiseException(exception, virtAddr);
+            buffer[length] = '\0';
+            return -1;
+        }
+        chunk = min(size - 1 - length,
+                    (int) (PageSize - (unsigned) virtAddr % PageSize));
+        for (from = &mainMemory[physicalAddress]; chunk > 0; chunk--) {
+            if ((buffer[length] = *from++) == '\0') {
+                return length;
+            }
+            length++;
+        }
+        virtAddr = (unsigned) virtAddr / PageSize * PageSize + PageSize;
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+//----------------------------------------------------------------------
+// Machine::LookupHostTLB
+// 	Look for a cached translation of "addr", so that ReadMem and
+//	WriteMem can skip Translate.  On a hit, set the use and dirty
+//	bits, and bump the reference count the LRU pager uses, just as
+//	Translate would.
+//
+//	Returns NULL -- and Translate must do the work, including 
+//	raising any exception -- if the page is not cached, if we are
+//	writing to a read-only page, or if the access is unaligned.
+//
+//	The cache is direct-mapped on the virtual page #.  It only 
+//	holds pages that Translate has let us access since the last 
+//	FlushHostTLB, so it cannot let through anything Translate 
+//	would not.
+//
+//	"addr" -- the virtual address to translate
+//	"size" -- the amount of memory being read or written
+// 	"writing" -- if TRUE, the page must be writable
+//----------------------------------------------------------------------
+
+HostTLBEntry *
+Machine::LookupHostTLB(int addr, int size, bool writing)
+{
+    unsigned int vpn = (unsigned) addr / PageSize;
+    HostTLBEntry *hit = &hostTLB[vpn % HostTLBSize];
+
+    if (hit->virtualPage != (int) vpn || (writing && !hit->writable)
+        || (addr & (size - 1)) != 0) {
+        return NULL;
+    }
+    if (writing) {
+        hit->entry->dirty = TRUE;
+    }
+    hit->entry->refed = TRUE;
+    hit->entry->refCount++;
+    return hit;
+}
+
+//----------------------------------------------------------------------
+// Machine::FillHostTLB
+// 	Remember the translation of "addr" that Translate just made, 
+//	using translation entry "entry".
+//
+//	We only cache translations from the page table.  The kernel is
+//	free to rewrite the contents of the TLB at any time, without 
+//	telling us.
+//----------------------------------------------------------------------
+
+void
+Machine::FillHostTLB(int addr, TranslationEntry *entry)
+{
+    unsigned int vpn = (unsigned) addr / PageSize;
+    HostTLBEntry *slot = &hostTLB[vpn % HostTLBSize];
+
+    if (tlb != NULL) {
+        return;
+    }
+    slot->virtualPage = vpn;
+    slot->page = &mainMemory[entry->physicalFrame * PageSize];
+    slot->entry = entry;
+    slot->writable = !entry->readOnly;
+}
+
 //----------------------------------------------------------------------
 // Machine::Translate
 // 	Translate a virtual address into a physical address, using 
@@ -183,25 +410,29 @@ bool Machine::WriteMem(int addr, int size, int value) {
 //	"physAddr" -- the place to store the physical address
 //	"size" -- the amount of memory being read or written
 // 	"writing" -- if TRUE, check the "read-only" bit in the TLB
+//	"entryPtr" -- if not NULL, where to return the translation entry
 //----------------------------------------------------------------------
 
-ExceptionType Machine::Translate(int virtAddr, int* physAddr, int size, bool writing) {
-    int i;
+template <bool traced>
+ExceptionType Machine::Translate(int virtAddr, int* physAddr, int size, bool writing,
+				 TranslationEntry **entryPtr) {
     unsigned int VirtualPageNum, offset;
     TranslationEntry *entry;
     unsigned int pageFrame;
 
-    DEBUG(dbgAddr, "\tTranslate 0x" << std::hex << virtAddr << (writing ? " , write" : " , read") << std::dec);
+    TRACE(dbgAddr, "\tTranslate 0x" << std::hex << virtAddr << (writing ? " , write" : " , read") << std::dec);
 
 // check for alignment errors
     if (((size == 4) && (virtAddr & 0x3)) || ((size == 2) && (virtAddr & 0x1))){
-        DEBUG(dbgAddr, "Alignment problem at 0x" << std::hex << virtAddr << ", size 0x" << size << std::dec);
+        TRACE(dbgAddr, "Alignment problem at 0x" << std::hex << virtAddr << ", size 0x" << size << std::dec);
         return AddressErrorException;
     }
     
     // we must have either a TLB or a page table, but not both!
-    ASSERT(tlb == NULL || pageTable == NULL);	
-    ASSERT(tlb != NULL || pageTable != NULL);	
+    if (traced) {
+        ASSERT(tlb == NULL || pageTable == NULL);	
+        ASSERT(tlb != NULL || pageTable != NULL);	
+    }
 
 // calculate the virtual page number, and offset within the page,
 // from the virtual address
@@ -210,32 +441,20 @@ ExceptionType Machine::Translate(int virtAddr, int* physAddr, int size, bool wri
     
     if (tlb == NULL) {		// => page table => vpn is index into table
         if (VirtualPageNum >= pageTableSize) {
-            DEBUG(dbgAddr, "Illegal virtual page # 0x" << std::hex << virtAddr << std::dec);
+            TRACE(dbgAddr, "Illegal virtual page # 0x" << std::hex << virtAddr << std::dec);
             return AddressErrorException;
         } else if (!pageTable[VirtualPageNum].valid) {
             /* 		Add Page fault code here		*/
-            DEBUG(dbgAddr, "Invalid virtual page # 0x" << std::hex << virtAddr << std::dec);
-            
-            uint32_t FreeFrameNum = UINT32_MAX;
-            try{
-                FreeFrameNum = AddrSpace::PopFreeFrame();
-            } catch(...){
-                TranslationEntry* victim = TranslationEntry::FindSwapVictim();
-                DEBUG(dbgAddr, "no FreeFrame, Swapping Victim Frame# = 0x" << std::hex << victim->physicalFrame << std::dec);
-                FreeFrameNum = victim->SwapOut();
-            }
-            pageTable[VirtualPageNum].SwapIn(FreeFrameNum);
+            TRACE(dbgAddr, "Invalid virtual page # 0x" << std::hex << virtAddr << std::dec);
+            EnterKernel();
+            kernel->stats->numPageFaults++;
+            pageTable[VirtualPageNum].PageIn();
         }    
         entry = &pageTable[VirtualPageNum];
     } else {
-        for (entry = NULL, i = 0; i < TLBSize; i++){
-    	    if (tlb[i].valid && (tlb[i].virtualPage == VirtualPageNum)) {
-                entry = &tlb[i];			// FOUND!
-                break;
-            }
-        }
+        entry = tlb->Lookup(VirtualPageNum);
         if (entry == NULL) {				// not found
-            DEBUG(dbgAddr, "Invalid TLB entry for this virtual page!");
+            TRACE(dbgAddr, "Invalid TLB entry for this virtual page!");
             return PageFaultException;		// really, this is a TLB fault,
                             // the page may be in memory,
                             // but not in the TLB
@@ -243,7 +462,7 @@ ExceptionType Machine::Translate(int virtAddr, int* physAddr, int size, bool wri
     }
 
     if (entry->readOnly && writing) {	// trying to write to a read-only page
-        DEBUG(dbgAddr, "Write to read-only page at 0x" << std::hex << virtAddr << std::dec);
+        TRACE(dbgAddr, "Write to read-only page at 0x" << std::hex << virtAddr << std::dec);
         return ReadOnlyException;
     }
     pageFrame = entry->physicalFrame;
@@ -251,7 +470,7 @@ ExceptionType Machine::Translate(int virtAddr, int* physAddr, int size, bool wri
     // if the pageFrame is too big, there is something really wrong! 
     // An invalid translation was loaded into the page table or TLB. 
     if (pageFrame >= NumPhysPages) { 
-        DEBUG(dbgAddr, "Illegal pageframe 0x" << std::hex << pageFrame << std::dec);
+        TRACE(dbgAddr, "Illegal pageframe 0x" << std::hex << pageFrame << std::dec);
         return BusErrorException;
     }
     if (writing){
@@ -260,19 +479,161 @@ ExceptionType Machine::Translate(int virtAddr, int* physAddr, int size, bool wri
     entry->refed = TRUE;    // set the use, dirty bits
     entry->refCount++;
     *physAddr = pageFrame * PageSize + offset;
-    ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
-    DEBUG(dbgAddr, "phys addr = 0x" << std::hex << *physAddr << ", frame = 0x" << pageFrame << std::dec);
+    if (entryPtr != NULL) {
+        *entryPtr = entry;
+    }
+    if (traced) {
+        ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
+    }
+    TRACE(dbgAddr, "phys addr = 0x" << std::hex << *physAddr << ", frame = 0x" << pageFrame << std::dec);
     
     return NoException;
 }
 
+// The simulator uses both versions of each of these (see machine.h).
+
+template bool Machine::ReadMem<TRUE>(int addr, int size, int *value);
+template bool Machine::ReadMem<FALSE>(int addr, int size, int *value);
+template bool Machine::WriteMem<TRUE>(int addr, int size, int value);
+template bool Machine::WriteMem<FALSE>(int addr, int size, int value);
+template ExceptionType Machine::Translate<TRUE>(int virtAddr, int* physAddr,
+			int size, bool writing, TranslationEntry **entryPtr);
+template ExceptionType Machine::Translate<FALSE>(int virtAddr, int* physAddr,
+			int size, bool writing, TranslationEntry **entryPtr);
+
+//----------------------------------------------------------------------
+// Machine::TranslateAny
+// 	Translate, for the kernel's copy routines.  With a TLB, a miss
+//	here is the kernel's own, touching the user program's memory for
+//	it: refill the TLB, as the handler would, and try again, rather 
+//	than raise an exception for the user program.
+//----------------------------------------------------------------------
+
+ExceptionType Machine::TranslateAny(int virtAddr, int* physAddr, bool writing) {
+    ExceptionType exception;
+
+    exception = tracing ? Translate<TRUE>(virtAddr, physAddr, 1, writing)
+                        : Translate<FALSE>(virtAddr, physAddr, 1, writing);
+    if (exception == PageFaultException && tlb != NULL
+        && kernel->currentThread->space->RefillTLB(virtAddr)) {
+        exception = tracing ? Translate<TRUE>(virtAddr, physAddr, 1, writing)
+                            : Translate<FALSE>(virtAddr, physAddr, 1, writing);
+    }
+    return exception;
+}
+
+//----------------------------------------------------------------------
+// ParallelCpu::Translate
+// 	Translate a virtual address for a processor running on a host 
+//	thread (see machine.h), the way Machine::Translate would with a
+//	linear page table -- except that we return FALSE for anything
+//	the kernel would have to handle, and that the use and dirty bits
+//	are only recorded, to be set by Commit.
+//----------------------------------------------------------------------
+
+bool ParallelCpu::Translate(int virtAddr, int* physAddr, int size, bool writing) {
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    TranslationEntry *entry;
+    PageUse use;
+
+    if (((size == 4) && (virtAddr & 0x3)) || ((size == 2) && (virtAddr & 0x1))) {
+        return FALSE;
+    }
+    if (vpn >= pageTableSize) {
+        return FALSE;
+    }
+    entry = &pageTable[vpn];
+    if (!entry->valid || (entry->readOnly && writing) 
+        || entry->physicalFrame >= NumPhysPages) {
+        return FALSE;
+    }
+    use.when = done;
+    use.entry = entry;
+    use.writing = writing;
+    uses.push_back(use);
+    *physAddr = entry->physicalFrame * PageSize + (unsigned) virtAddr % PageSize;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ParallelCpu::ReadMem
+// ParallelCpu::WriteMem
+// 	Machine::ReadMem and WriteMem, for a processor running on a host
+//	thread.  WriteMem logs what it overwrites, so Commit can undo it.
+//	"traced" is always FALSE; it is only there for mipsops.h.
+//----------------------------------------------------------------------
+
+template <bool traced>
+bool ParallelCpu::ReadMem(int addr, int size, int *value) {
+    int physAddr;
+    char *where;
+
+    if (!Translate(addr, &physAddr, size, FALSE)) {
+        return FALSE;
+    }
+    where = &machine->mainMemory[physAddr];
+    switch (size) {
+      case 1:
+        *value = *where;
+        break;
+      case 2:
+        *value = ShortToHost(*(unsigned short *) where);
+        break;
+      case 4:
+        *value = WordToHost(*(unsigned int *) where);
+        break;
+      default:
+        ASSERT(FALSE);
+    }
+    return TRUE;
+}
+
+template <bool traced>
+bool ParallelCpu::WriteMem(int addr, int size, int value) {
+    int physAddr;
+    char *where;
+    MemoryUndo u;
+
+    if (!Translate(addr, &physAddr, size, TRUE)) {
+        return FALSE;
+    }
+    where = &machine->mainMemory[physAddr];
+    u.when = done;
+    u.physAddr = physAddr;
+    u.size = size;
+    bcopy(where, &u.old, size);
+    undo.push_back(u);
+    machine->InvalidateFrame(physAddr / PageSize);	// self-modifying code
+    switch (size) {
+      case 1:
+        *where = (unsigned char) (value & 0xff);
+        break;
+      case 2:
+        *(unsigned short *) where
+            = ShortToMachine((unsigned short) (value & 0xffff));
+        break;
+      case 4:
+        *(unsigned int *) where = WordToMachine((unsigned int) value);
+        break;
+      default:
+        ASSERT(FALSE);
+    }
+    return TRUE;
+}
+
+template bool ParallelCpu::ReadMem<FALSE>(int addr, int size, int *value);
+template bool ParallelCpu::WriteMem<FALSE>(int addr, int size, int value);
+
 TranslationEntry *TranslationEntry::FindSwapVictim(void) {
     TranslationEntry * entry = nullptr;
+    if (kernel->machine->tlb != NULL) {
+        kernel->machine->tlb->WriteBack();	// the latest use counts
+    }
     switch (AddrSpace::SwapMethod) {
     case FIFO: {
         uint32_t MinID = kernel->machine->ReverseTable[0]->entry->ID;
         entry = kernel->machine->ReverseTable[0]->entry;
-        for (int i = 1; i < NumPhysPages; ++i) {
+        for (unsigned int i = 1; i < NumPhysPages; ++i) {
             if (MinID > kernel->machine->ReverseTable[i]->entry->ID){
                 MinID = kernel->machine->ReverseTable[i]->entry->ID; 
                 entry = kernel->machine->ReverseTable[i]->entry;
@@ -283,7 +644,7 @@ TranslationEntry *TranslationEntry::FindSwapVictim(void) {
     case LRU: {
         uint32_t MinRef = kernel->machine->ReverseTable[0]->entry->refCount;
         entry = kernel->machine->ReverseTable[0]->entry;
-        for (int i = 1; i < NumPhysPages; ++i) {
+        for (unsigned int i = 1; i < NumPhysPages; ++i) {
             if (MinRef > kernel->machine->ReverseTable[i]->entry->refCount){
                 MinRef = kernel->machine->ReverseTable[i]->entry->refCount; 
                 entry = kernel->machine->ReverseTable[i]->entry;
@@ -298,12 +659,25 @@ TranslationEntry *TranslationEntry::FindSwapVictim(void) {
     return nullptr;
 }
 
+void TranslationEntry::PageIn(void) {
+    uint32_t FreeFrameNum = UINT32_MAX;
+    try{
+        FreeFrameNum = AddrSpace::PopFreeFrame();
+    } catch(...){
+        TranslationEntry* victim = TranslationEntry::FindSwapVictim();
+        DEBUG(dbgAddr, "no FreeFrame, Swapping Victim Frame# = 0x" << std::hex << victim->physicalFrame << std::dec);
+        FreeFrameNum = victim->SwapOut();
+    }
+    SwapIn(FreeFrameNum);
+}
+
 void TranslationEntry::SwapIn(uint32_t FrameNum) {
     this->physicalFrame = FrameNum;
     cout << "Swapping: Frame 0x" << std::hex << this->physicalFrame << " from Sector 0x" << this->diskSector << std::dec << endl;
     // DEBUG(dbgAddr, "Swapping: Frame 0x" << std::hex << this->physicalFrame << " from Sector 0x" << this->diskSector << std::dec);
     char* buf = new char[SectorSize];
     kernel->SwapDisk->ReadSector(this->diskSector, kernel->machine->mainMemory + this->physicalFrame*PageSize);
+    kernel->machine->InvalidateFrame(this->physicalFrame);
     kernel->machine->ReverseTable[this->physicalFrame]->entry = this;
 
     // zero out the Sector
@@ -332,6 +706,11 @@ uint32_t TranslationEntry::SwapOut(void) {
     
     // zero out the mainmemory
     bzero(kernel->machine->mainMemory + this->physicalFrame*PageSize, PageSize);
+    kernel->machine->InvalidateFrame(this->physicalFrame);
+    kernel->machine->FlushHostTLB();
+    if (kernel->machine->tlb != NULL) {
+        kernel->machine->tlb->Invalidate(this);
+    }
     kernel->machine->ReverseTable[this->physicalFrame]->entry = nullptr;
     AddrSpace::PushFreeFrame(this->physicalFrame);
     
@@ -33,10 +33,14 @@ class TranslationEntry {
     static uint32_t MaxID; // 0 for pages in disk
     static uint32_t LastSwapIn;
     static uint32_t LastSwapOut;
+    friend class Checkpoint;	// saves and restores these
   public:
     static TranslationEntry* FindSwapVictim(void);
     static inline uint32_t AssignNewID(void) { return (!(++MaxID)) ? ++MaxID : MaxID; }
 
+    // Bring into MainMemory, in a free frame or a victim's
+    void PageIn(void);
+
     // SwapIn to MainMemory FrameNum
     void SwapIn(uint32_t FrameNum);
 
@@ -0,0 +1,57 @@
+/* perf.c 
+ *    Test program to time the phases of a program with the performance
+ *    counters (see PerfCounter in syscall.h).
+ *
+ *    Multiplies two matrices, like matmult, and prints the instructions,
+ *    user ticks and page faults each phase took.
+ */
+
+#include "syscall.h"
+
+#define Dim 	20
+
+int A[Dim][Dim];
+int B[Dim][Dim];
+int C[Dim][Dim];
+
+int instrs, ticks, faults;	/* at the start of the phase */
+
+void
+StartPhase()
+{
+    instrs = PerfCounter(PerfInstructions, PerfProcess);
+    ticks = PerfCounter(PerfUserTicks, PerfProcess);
+    faults = PerfCounter(PerfPageFaults, PerfProcess);
+}
+
+void
+EndPhase()
+{
+    PrintInt(PerfCounter(PerfInstructions, PerfProcess) - instrs);
+    PrintInt(PerfCounter(PerfUserTicks, PerfProcess) - ticks);
+    PrintInt(PerfCounter(PerfPageFaults, PerfProcess) - faults);
+}
+
+int
+main()
+{
+    int i, j, k;
+
+    StartPhase();
+    for (i = 0; i < Dim; i++)		/* first initialize the matrices */
+	for (j = 0; j < Dim; j++) {
+	     A[i][j] = i;
+	     B[i][j] = j;
+	     C[i][j] = 0;
+	}
+    EndPhase();
+
+    StartPhase();
+    for (i = 0; i < Dim; i++)		/* then multiply them together */
+	for (j = 0; j < Dim; j++)
+            for (k = 0; k < Dim; k++)
+		 C[i][j] += A[i][k] * B[k][j];
+    EndPhase();
+
+    Exit(C[Dim-1][Dim-1]);		/* and then we're done */
+}
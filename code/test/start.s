@@ -202,6 +202,14 @@ Print:
 	j       $31
 	.end Print
 
+	.globl  PerfCounter
+	.ent    PerfCounter
+PerfCounter:
+	addiu   $2,$0,SC_PerfCounter
+	syscall
+	j       $31
+	.end PerfCounter
+
 
 /* dummy function to keep gcc happy */
         .globl  __main
@@ -11,6 +11,9 @@
 #include "copyright.h"
 #include "alarm.h"
 #include "main.h"
+#ifdef USER_PROGRAM
+#include "sampler.h"
+#endif
 
 //----------------------------------------------------------------------
 // Alarm::Alarm
@@ -18,9 +21,19 @@
 //
 //      "doRandom" -- if true, arrange for the hardware interrupts to 
 //		occur at random, instead of fixed, intervals.
+//	"tickless" -- if true, stop the periodic interrupts while they
+//		have nothing to do (see CanStop).  Not with random
+//		intervals, or intervals replayed from a log: there is
+//		no period to skip ahead by.
 //----------------------------------------------------------------------
 
-Alarm::Alarm(bool doRandom) {
+Alarm::Alarm(bool doRandom, bool tickless) {
+    EventLog *log = kernel->eventLog;
+
+    this->tickless = tickless && !doRandom
+		     && (log == NULL || !log->Replaying());
+    stopped = FALSE;
+    lastTick = kernel->stats->totalTicks;
     timer = new Timer(doRandom, this);
 }
 
@@ -43,25 +56,161 @@ Alarm::Alarm(bool doRandom) {
 //	Also, to keep from looping forever, we check if there's
 //	nothing on the ready list, and there are no other pending
 //	interrupts.  In this case, we can safely halt.
+//
+//	With -sample, this is also where the running user program is
+//	sampled (see sampler.h).
+//
+//	Sleeping threads are woken by an interrupt of their own (see
+//	sleepFunc), not here.
+//
+//	With -tickless, if the ticks to come have nothing to do, we stop
+//	them: the timer is turned off until something changes.  What
+//	the ticks skipped would have counted is caught up when we start
+//	ticking again.
 //----------------------------------------------------------------------
 
 void Alarm::CallBack() {
     Interrupt *interrupt = kernel->interrupt;
     MachineStatus status = interrupt->getStatus();
 
-    bool woken = sleeper.wakeUp();
+    lastTick = kernel->stats->totalTicks;
+
+#ifdef USER_PROGRAM
+    if (status == UserMode && Sampler::Sampling()) {
+        Sampler::Tick();
+    }
+#endif
     kernel->currentThread->setPriority(kernel->currentThread->getPriority() - 1);
-    if (status == IdleMode && !woken && sleeper.isEmpty()) {	// is it time to quit?
+    if (status == IdleMode) {	// is it time to quit?
         if (!interrupt->AnyFutureInterrupts()) {
 	        timer->Disable();	// turn off the timer
+	        return;
         }
     } else {			// there's someone to preempt
-        if(kernel->scheduler->getSchedulerType() == RR) {
+        // with several processors, each one's own timer does the
+        // time-slicing (see Scheduler::CpuTick)
+        if(kernel->scheduler->getSchedulerType() == RR
+           && kernel->scheduler->NumCpus() == 1) {
             interrupt->YieldOnReturn();
         }
     }
+    if (tickless && CanStop(status)) {
+        stopped = TRUE;
+        timer->Disable();
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::CanStop
+//	Return TRUE if the ticks to come would do nothing that can't be
+//	caught up later, so that we can stop them until something
+//	changes: a thread is put on the ready list (by a device, or a
+//	sleeper's wakeup), or the CPU idles with nothing else to do.
+//
+//	That is when there is at most one thread to run, on one CPU,
+//	and it isn't being sampled; and, with round robin, it isn't
+//	running: time-slicing it, even with no one to switch to, costs
+//	simulated time.
+//
+//	"status" -- what the CPU was doing when the timer went off
+//----------------------------------------------------------------------
+
+bool Alarm::CanStop(MachineStatus status) {
+    Scheduler *scheduler = kernel->scheduler;
+
+    if (scheduler->AnyReady() || scheduler->NumCpus() > 1
+        || (status != IdleMode && scheduler->getSchedulerType() == RR)) {
+        return FALSE;
+    }
+#ifdef USER_PROGRAM
+    if (Sampler::Sampling()) {
+        return FALSE;
+    }
+#endif
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Alarm::CatchUp
+//	Do what "ticks" ticks that were skipped would have done: lower
+//	the current thread's priority.
+//----------------------------------------------------------------------
+
+void Alarm::CatchUp(int ticks) {
+    if (ticks > 0) {
+        kernel->currentThread->setPriority(
+                kernel->currentThread->getPriority() - ticks);
+    }
 }
 
+//----------------------------------------------------------------------
+// Alarm::Restart
+//	Start ticking again, at the same times as if we had never
+//	stopped: catch up the ticks since the last one, and program the
+//	timer for the next.
+//
+//	If a tick is due right now, it isn't caught up: it is handled
+//	here and now, as it would have been in the same round of
+//	interrupts, and the timer is programmed for the one after.  We
+//	can't schedule it for now instead; an interrupt must be in the
+//	future.
+//----------------------------------------------------------------------
+
+void Alarm::Restart() {
+    int period = kernel->stats->schdulerTicks;
+    Ticks now = kernel->stats->totalTicks;
+    int skipped = (now - lastTick) / period;
+    bool dueNow = skipped > 0 && (now - lastTick) % period == 0;
+
+    if (dueNow) {
+        skipped--;
+    }
+    CatchUp(skipped);
+    lastTick += (Ticks) skipped * period;
+    stopped = FALSE;
+    if (dueNow) {
+        timer->Reprogram(period);	// as Timer::CallBack would, but
+        CallBack();			// first, in case this turns the
+					// timer off again
+    } else {
+        timer->Reprogram(lastTick + period - now);
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::ThreadReady
+//	Called by Scheduler::ReadyToRun, once the thread is on the ready
+//	list: with a thread to switch to, or to lower the priority of,
+//	the ticks have something to do again.
+//----------------------------------------------------------------------
+
+void Alarm::ThreadReady() {
+    if (stopped) {
+        Restart();
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::Idling
+//	Called when the CPU is about to idle.  If the ticks are stopped
+//	and nothing else is scheduled, restart them, so that the next
+//	one finds nothing to do and turns the timer off, and Nachos
+//	halts, at the same time as if they had never stopped.  A tick
+//	due now would have found the CPU idle, so say it is.
+//----------------------------------------------------------------------
+
+void Alarm::Idling() {
+    if (stopped && !kernel->interrupt->AnyFutureInterrupts()) {
+        kernel->interrupt->setStatus(IdleMode);
+        Restart();
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::WaitUntil
+//	Put the current thread to sleep for "x" ticks (see sleepFunc).
+//----------------------------------------------------------------------
+
 void Alarm::WaitUntil(int x) {
     IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
     Thread* t = kernel->currentThread;
@@ -26,19 +26,41 @@
 // The following class defines a software alarm clock. 
 class Alarm : public CallBackObj {
   public:
-    Alarm(bool doRandomYield);	// Initialize the timer, and callback 
+    Alarm(bool doRandomYield, bool tickless);
+				// Initialize the timer, and callback 
 				// to "toCall" every time slice.
     ~Alarm() { delete timer; }
     
-    void WaitUntil(int x);	// suspend execution until time > now + x
+    void WaitUntil(int x);	// suspend execution until time >= now + x
+
+    void ThreadReady();		// A thread has been put on the ready
+				// list; with -tickless, start ticking
+    void Idling();		// The CPU is about to idle; with
+				// -tickless, tick if there is nothing
+				// else to wait for
 
   private:
     Timer *timer;		// the hardware timer device
 
     sleepFunc sleeper;
 
+    bool tickless;		// stop the periodic tick when it has
+				// nothing to do (-tickless)?
+    bool stopped;		// is it stopped?
+    Ticks lastTick;		// when the timer last interrupted
+
     void CallBack();		// called when the hardware
 				// timer generates an interrupt
+    bool CanStop(MachineStatus status);
+				// Could the ticks to come be skipped?
+    void CatchUp(int ticks);	// Do what "ticks" skipped ticks would
+				// have done
+    void Restart();		// Tick again, from where we would have
+				// been
+
+    friend class Checkpoint;	// checks the sleepers, saves and
+				// restores the ticks, and re-schedules
+				// the timer
 };
 
 #endif // ALARM_H
@@ -25,19 +25,49 @@
 
 ThreadedKernel::ThreadedKernel(int argc, char **argv) {
     randomSlice = FALSE; 
+    randomSeed = 1;
+    tickless = FALSE;
     type = RR;
     
     this->SchedulerTickTime = 100;
+    numCpus = 1;
+    eventLogName = NULL;
+    replaying = FALSE;
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-rs") == 0) {
  	    ASSERT(i + 1 < argc);
-	    RandomInit(atoi(argv[i + 1]));// initialize pseudo-random
+	    randomSeed = atoi(argv[i + 1]);
+	    RandomInit(randomSeed);	// initialize pseudo-random
 					// number generator
 	    randomSlice = TRUE;
 	    i++;
         } else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-rs randomSeed]\n";
+            cout << "Partial usage: nachos [-ncpu numProcessors]\n";
+            cout << "Partial usage: nachos [-record filename]\n";
+            cout << "Partial usage: nachos [-replay filename]\n";
+            cout << "Partial usage: nachos [-tickless]\n";
+        } else if (strcmp(argv[i], "-tickless") == 0) {
+            tickless = TRUE;
+        } else if (strcmp(argv[i], "-ncpu") == 0) {
+            ASSERT(i + 1 < argc);
+            numCpus = atoi(argv[i + 1]);
+            if (numCpus < 1 || numCpus > MaxCpus) {
+                cout << "-ncpu must be between 1 and " << MaxCpus << endl;
+                numCpus = 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-record") == 0) {
+            ASSERT(i + 1 < argc);
+            eventLogName = argv[i + 1];
+            replaying = FALSE;
+            i++;
+        } else if (strcmp(argv[i], "-replay") == 0) {
+            ASSERT(i + 1 < argc);
+            eventLogName = argv[i + 1];
+            replaying = TRUE;
+            i++;
 	    } else if(strcmp(argv[i], "-sche") == 0) {
             if (!(i + 1 < argc)){
                 cout << "Partial usage: nachos [-sche Schedluer Type]\n";
@@ -72,15 +102,27 @@ ThreadedKernel::Initialize() {
     stats = new Statistics();		// collect statistics
     kernel->stats->schdulerTicks = this->SchedulerTickTime;
 
+    eventLog = NULL;			// events from outside, before
+    if (eventLogName != NULL) {		// the devices that use them
+	eventLog = new EventLog(eventLogName, replaying);
+	if (!replaying) {		// with the seed, so the replay
+					// draws the same random numbers
+	    eventLog->Record(SeedEvent, &randomSeed, sizeof(randomSeed));
+	} else if (eventLog->Replay(SeedEvent, &randomSeed, sizeof(randomSeed))) {
+	    RandomInit(randomSeed);
+	}
+    }
     interrupt = new Interrupt;		// start up interrupt handling
     scheduler = new Scheduler(type);	// initialize the ready queue
-    alarm = new Alarm(randomSlice);	// start up time slicing
+    alarm = new Alarm(randomSlice, tickless);
+					// start up time slicing
 
     // We didn't explicitly allocate the current thread we are running in.
     // But if it ever tries to give up the CPU, we better have a Thread
     // object to save its state. 
     currentThread = new Thread("main");		
     currentThread->setStatus(RUNNING);
+    scheduler->SetNumCpus(numCpus);	// "main" is on processor 0
 
     interrupt->Enable();
 }
@@ -95,6 +137,9 @@ ThreadedKernel::~ThreadedKernel() {
     delete scheduler;
     delete interrupt;
     delete stats;
+    if (eventLog != NULL) {
+	delete eventLog;
+    }
     
     Exit(0);
 }
@@ -142,5 +187,7 @@ ThreadedKernel::SelfTest() {
    synchList->SelfTest(9);
    delete synchList;
 
+   interrupt->SelfTest();	// test interrupt ordering
+
    ElevatorSelfTest();
 }
@@ -16,6 +16,7 @@
 #include "interrupt.h"
 #include "stats.h"
 #include "alarm.h"
+#include "eventlog.h"
 
 class ThreadedKernel {
   public:
@@ -41,11 +42,20 @@ class ThreadedKernel {
     Interrupt *interrupt;	// interrupt status
     Statistics *stats;		// performance metrics
     Alarm *alarm;		// the software alarm clock    
+    EventLog *eventLog;		// events from outside being recorded
+				// or replayed, or NULL
 
   private:
     bool randomSlice;		// enable pseudo-random time slicing
+    unsigned int randomSeed;	// what RandomInit was given, or 1,
+				// rand's own seed, if it wasn't called
+    bool tickless;		// stop the timer while it has nothing
+				// to do
     SchedulerType type;
     int SchedulerTickTime;
+    int numCpus;		// # of processors to simulate
+    char *eventLogName;		// where to record or replay events
+    bool replaying;		//   and which
 };
 
 
@@ -4,7 +4,9 @@
 //
 // 	These routines assume that interrupts are already disabled.
 //	If interrupts are disabled, we can assume mutual exclusion
-//	(since we are on a uniprocessor).
+//	(since we are on a uniprocessor -- or, with -ncpu, we simulate
+//	only one processor at a time, and only switch between them 
+//	between two user instructions).
 //
 // 	NOTE: We can't use Locks to provide mutual exclusion here, since
 // 	if we needed to wait for a lock, and the lock was busy, we would 
@@ -22,6 +24,7 @@
 #include "debug.h"
 #include "scheduler.h"
 #include "main.h"
+#include <algorithm>
 
 //----------------------------------------------------------------------
 // Compare function
@@ -65,6 +68,13 @@ Scheduler::Scheduler(SchedulerType type) {
             break;
     }
 	toBeDestroyed = NULL;
+	numCpus = 1;
+	currentCpu = 0;
+	for (int i = 0; i < MaxCpus; i++) {
+	    cpuThread[i] = NULL;
+	}
+	quantumLeft = CpuQuantum;
+	parallel = FALSE;
 } 
 
 //----------------------------------------------------------------------
@@ -90,6 +100,8 @@ void Scheduler::ReadyToRun (Thread *thread) {
     
     thread->setStatus(READY);
     readyList->Append(thread);
+    kernel->alarm->ThreadReady();	// with -tickless, the clock may
+					// have to start ticking
 }
 
 //----------------------------------------------------------------------
@@ -150,6 +162,7 @@ void Scheduler::Run (Thread *nextThread, bool finishing) {
 					    // had an undetected stack overflow
 
     kernel->currentThread = nextThread;  // switch to the next thread
+    cpuThread[currentCpu] = nextThread;
     nextThread->setStatus(RUNNING);      // nextThread is now running
     
     DEBUG(dbgThread, "Switching from: " << oldThread->getName() << " to: " << nextThread->getName());
@@ -207,28 +220,326 @@ Scheduler::Print() {
     readyList->Apply(ThreadPrint);
 }
 
+//----------------------------------------------------------------------
+// Scheduler::SetNumCpus
+// 	Simulate "n" processors, sharing the ready list, main memory,
+//	and the interrupt queue, instead of one.  Called once, at 
+//	startup, while "main" is running on processor 0.
+//
+//	Each processor has its own current thread (cpuThread) and its 
+//	own time-slice timer (sliceLeft).  It has its own registers too,
+//	but since only one processor is simulated at a time, those can
+//	stay in the machine while it runs, and in the thread when it
+//	doesn't -- exactly as for a context switch.
+//----------------------------------------------------------------------
+
+void
+Scheduler::SetNumCpus(int n) {
+    ASSERT(1 <= n && n <= MaxCpus);
+    numCpus = n;
+    for (int i = 0; i < n; i++) {
+        sliceLeft[i] = kernel->stats->schdulerTicks;
+    }
+    cpuThread[currentCpu] = kernel->currentThread;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::OnClockCpu
+// 	Return TRUE if the processor we are simulating is the busy one 
+//	with the lowest number.
+//
+//	All processors run at the same time, so a round of turns takes
+//	CpuQuantum ticks of simulated time, not numCpus * CpuQuantum.
+//	We get that by letting only one processor's user instructions
+//	advance the clock (see Interrupt::OneTick); the others just 
+//	count their user ticks.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::OnClockCpu() {
+    int i;
+
+    for (i = 0; i < numCpus - 1 && cpuThread[i] == NULL; i++) {
+    }
+    return i == currentCpu;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::CpuTick
+// 	Called, with interrupts disabled, after every user instruction
+//	when there is more than one processor.
+//
+//	When the current processor's turn is over, switch to the next
+//	one's thread.  We return here once our own processor's turn
+//	comes around again; if its timer has gone off in the meantime,
+//	the thread on it yields, as on a timer interrupt (for RR).
+//
+//	With -parallel, first try to run whole rounds of turns on host
+//	threads (see RunParallel).
+//----------------------------------------------------------------------
+
+void
+Scheduler::CpuTick() {
+    int cpu = -1;
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    sliceLeft[currentCpu]--;
+    if (--quantumLeft > 0) {
+        return;
+    }
+#ifdef USER_PROGRAM
+    while (parallel && cpu == -1 && RunParallel(&cpu)) {
+    }				// whole rounds, until a processor stops
+    if (cpu == currentCpu) {
+        return;			// part way through our own turn
+    }
+#endif
+    if (cpu != -1) {		// part way through its turn
+        DEBUG(dbgThread, "Switching from processor " << currentCpu << " to " << cpu);
+        currentCpu = cpu;
+        Run(cpuThread[cpu], FALSE);
+    } else {
+        NextCpu();
+    }
+    if (sliceLeft[currentCpu] <= 0) {
+        sliceLeft[currentCpu] = kernel->stats->schdulerTicks;
+        if (schedulerType == RR) {
+            kernel->currentThread->Yield();
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::NextCpu
+// 	Give the next processor, in round-robin order, its turn: switch
+//	to the thread running on it, or, if it is idle and some thread
+//	is ready, start that thread on it.  Processors that are idle 
+//	with nothing to run are skipped; if that is all of the others,
+//	the current processor just gets another turn.
+//----------------------------------------------------------------------
+
+void
+Scheduler::NextCpu() {
+    int cpu = currentCpu;
+    Thread *nextThread;
+
+    quantumLeft = CpuQuantum;
+    do {
+        cpu = (cpu + 1) % numCpus;
+    } while (cpu != currentCpu && cpuThread[cpu] == NULL 
+             && readyList->IsEmpty());
+    if (cpu == currentCpu) {
+        return;
+    }
+    nextThread = cpuThread[cpu];
+    if (nextThread == NULL) {
+        nextThread = FindNextToRun();
+    }
+    DEBUG(dbgThread, "Switching from processor " << currentCpu << " to " << cpu);
+    currentCpu = cpu;
+    Run(nextThread, FALSE);
+}
+
+#ifdef USER_PROGRAM
+//----------------------------------------------------------------------
+// Scheduler::RunParallel
+// 	Called at the end of the current processor's turn (nachos 
+//	-parallel).  Rather than simulating the processors' turns one at
+//	a time, run the next few rounds of them all at once, each busy
+//	processor on its own host thread (see Machine::RunParallel).
+//
+//	That is only safe while nothing the processors do can depend on
+//	each other, or on the kernel, so we only do it when:
+//	   - no interrupt is due until the rounds are over (the clock 
+//	     only advances on one processor: CpuQuantum ticks a round);
+//	   - no processor's time slice runs out before then;
+//	   - no idle processor would pick up a ready thread instead;
+//	   - every busy processor has an address space of its own.
+//	A processor that needs the kernel (a system call, a page fault)
+//	stops just before that instruction.  We then keep exactly what 
+//	would have run before it, in the serial order of turns, and undo
+//	the rest; the processor that stopped goes on from there, one 
+//	instruction at a time.  So the result, and the simulated time of
+//	everything, is the same as without -parallel.
+//
+//	Return FALSE if we could not run anything.  Otherwise, set 
+//	"*stopped" to the processor that stopped (its turn has been 
+//	partly run, leaving quantumLeft instructions; the caller must 
+//	switch to it), or -1 if none did: then we are at the end of the 
+//	current processor's turn again.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::RunParallel(int *stopped) {
+    Machine *machine = kernel->machine;
+    int order[MaxCpus];		// the busy processors, in turn order
+    int n = 0;
+    int rounds, cpu, kept, clockCpu = numCpus;
+    int first = -1, firstRound = 0;	// where, in turn order, the first
+					// processor to stop stopped
+    Thread *thread;
+
+    rounds = min((kernel->interrupt->NextDue() - kernel->stats->totalTicks - 1)
+		 / (CpuQuantum * UserTick), (Ticks) MaxParallelRounds);
+    for (int i = 1; i <= numCpus; i++) {
+        cpu = (currentCpu + i) % numCpus;
+        thread = cpuThread[cpu];
+        if (thread == NULL) {
+            if (!readyList->IsEmpty()) {
+                return FALSE;
+            }
+            continue;
+        }
+        if (thread->space == NULL) {
+            return FALSE;
+        }
+        for (int j = 0; j < n; j++) {
+            if (cpuThread[order[j]]->space == thread->space) {
+                return FALSE;
+            }
+        }
+        rounds = min(rounds, (sliceLeft[cpu] - 1) / CpuQuantum);
+        clockCpu = min(clockCpu, cpu);
+        order[n++] = cpu;
+    }
+    if (n < 2 || rounds < 1) {
+        return FALSE;
+    }
+
+    kernel->currentThread->SaveUserState();
+    kernel->currentThread->space->SaveState();
+    for (int i = 0; i < n; i++) {
+        thread = cpuThread[order[i]];
+        machine->GetParallelCpu(i)->Start(thread->UserRegisters(),
+                thread->space->PageTable(), thread->space->NumPages(),
+                rounds * CpuQuantum, CpuQuantum);
+    }
+    machine->RunParallel(n);
+
+    for (int i = 0; i < n; i++) {
+        kept = machine->GetParallelCpu(i)->Done();
+        if (kept < rounds * CpuQuantum 
+            && (first == -1 || kept / CpuQuantum < firstRound)) {
+            first = i;
+            firstRound = kept / CpuQuantum;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        if (first == -1) {
+            kept = rounds * CpuQuantum;
+        } else if (i < first) {		// had its turn in that round
+            kept = (firstRound + 1) * CpuQuantum;
+        } else if (i == first) {
+            kept = machine->GetParallelCpu(i)->Done();
+        } else {			// its turn in that round is to come
+            kept = firstRound * CpuQuantum;
+        }
+        machine->GetParallelCpu(i)->Commit(kept);
+        cpuThread[order[i]]->space->ChargeParallel(kept);
+        sliceLeft[order[i]] -= kept;
+        kernel->stats->userTicks += kept * UserTick;
+        kernel->stats->numUserInstructions += kept;
+        if (order[i] == clockCpu) {	// see OnClockCpu
+            kernel->stats->totalTicks += kept * UserTick;
+        }
+    }
+    kernel->currentThread->RestoreUserState();
+    kernel->currentThread->space->RestoreState();
+
+    if (first == -1) {
+        *stopped = -1;
+    } else {
+        *stopped = order[first];
+        quantumLeft = CpuQuantum 
+            - (machine->GetParallelCpu(first)->Done() - firstRound * CpuQuantum);
+    }
+    return TRUE;
+}
+#endif
+
+//----------------------------------------------------------------------
+// Scheduler::IdleCpu
+// 	Called when the current thread is going to sleep and there is
+//	nothing on the ready list.  Mark the current processor idle, and
+//	return the thread on the next busy processor, which becomes the
+//	current one.  Return NULL if no other processor is busy; then
+//	there is really nothing to do but wait for an interrupt.
+//----------------------------------------------------------------------
+
+Thread*
+Scheduler::IdleCpu() {
+    int cpu;
+
+    cpuThread[currentCpu] = NULL;
+    for (int i = 1; i < numCpus; i++) {
+        cpu = (currentCpu + i) % numCpus;
+        if (cpuThread[cpu] != NULL) {
+            DEBUG(dbgThread, "Processor " << currentCpu << " idle, switching to " << cpu);
+            currentCpu = cpu;
+            quantumLeft = CpuQuantum;
+            return cpuThread[cpu];
+        }
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// sleepFunc::wakesLater
+//	The order of the heap of sleepers: the one due last is
+//	"smallest", so the heap keeps the first due at its front.
+//----------------------------------------------------------------------
+
+bool sleepFunc::wakesLater(const sleep_T &x, const sleep_T &y) {
+    return x.when > y.when
+           || (x.when == y.when && (int) (x.order - y.order) > 0);
+}
+
 bool sleepFunc::isEmpty() {
     return T_list.size() == 0;
 }
 
+//----------------------------------------------------------------------
+// sleepFunc::napTime
+//	Put thread "t" to sleep until "x" ticks from now, at least one.
+//----------------------------------------------------------------------
+
 void sleepFunc::napTime(Thread *t, int x) {
     ASSERT(kernel->interrupt->getLevel() == IntOff);
-    T_list.push_back(sleep_T(t, currentINT + x));
+    T_list.push_back(sleep_T(t, kernel->stats->totalTicks + max(x, 1), naps++));
+    std::push_heap(T_list.begin(), T_list.end(), wakesLater);
+    if (T_list.front().sleepThread == t) {	// it is the first due
+        setWakeup();
+    }
     t->Sleep(false);
 }
 
-bool sleepFunc::wakeUp() {
-    bool woken = false;
-    currentINT++;
-    for(std::list<sleep_T>::iterator it = T_list.begin(); it != T_list.end();) {
-        if(currentINT >= it->when) {
-            woken = true;
-            cout << "sleepFunc::wakeUP Thread woken" << endl;
-            kernel->scheduler->ReadyToRun(it->sleepThread);
-            it = T_list.erase(it);
-        } else {
-            it++;
-        }
+//----------------------------------------------------------------------
+// sleepFunc::setWakeup
+//	Have the wakeup interrupt go off when the first sleeper is due.
+//----------------------------------------------------------------------
+
+void sleepFunc::setWakeup() {
+    int fromNow = T_list.front().when - kernel->stats->totalTicks;
+
+    if (!kernel->interrupt->Reschedule(wakeup, fromNow)) {
+        wakeup = kernel->interrupt->Schedule(this, fromNow, AlarmInt);
+    }
+}
+
+//----------------------------------------------------------------------
+// sleepFunc::CallBack
+//	The wakeup interrupt: put every thread that is due on the ready
+//	list, and schedule the wakeup for the next.
+//----------------------------------------------------------------------
+
+void sleepFunc::CallBack() {
+    while (!T_list.empty() && T_list.front().when <= kernel->stats->totalTicks) {
+        cout << "sleepFunc::wakeUP Thread woken" << endl;
+        kernel->scheduler->ReadyToRun(T_list.front().sleepThread);
+        std::pop_heap(T_list.begin(), T_list.end(), wakesLater);
+        T_list.pop_back();
+    }
+    if (!T_list.empty()) {
+        setWakeup();
     }
-    return woken;
-}
\ No newline at end of file
+}
@@ -12,12 +12,24 @@
 #include "copyright.h"
 #include "list.h"
 #include "thread.h"
-#include <list>
+#include "callback.h"
+#include "interrupt.h"
+#include <vector>
 
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
 // thread is running, and which threads are ready but not running.
 
+// Simulated multiprocessor support (nachos -ncpu N).  We only ever 
+// simulate one processor at a time; they take turns, round robin, 
+// each running CpuQuantum user instructions before the next one
+// gets a turn.  See Scheduler::CpuTick.
+
+const int MaxCpus = 8;		// most processors we can simulate
+const int CpuQuantum = 10;	// # of user instructions in a turn
+const int MaxParallelRounds = 100;	// most rounds of turns to run on
+					// host threads at once (-parallel)
+
 enum SchedulerType {
         RR,     // Round Robin
         SJF,
@@ -25,21 +37,34 @@ enum SchedulerType {
 		FCFS
 };
 
-class sleepFunc {
+// The threads sleeping in Alarm::WaitUntil, in a heap by the tick
+// they are due to wake up at, the first due at the front.  A wakeup
+// interrupt is kept scheduled for that one, so each thread wakes at
+// the tick it asked for, whatever the time slice, and putting one to
+// sleep or waking one takes time logarithmic in the number asleep.
+
+class sleepFunc : public CallBackObj {
 public:
-	sleepFunc() : currentINT(0) {};
-	void napTime(Thread* t, int x);
-	bool wakeUp();
+	sleepFunc() : naps(0) {};
+	void napTime(Thread* t, int x);	// put "t" to sleep for "x" ticks
 	bool isEmpty();
+	void CallBack();	// the wakeup interrupt: wake those due
 private:
 	class sleep_T{
 	public:
-		sleep_T(Thread* t, int x) : sleepThread(t), when(x) {};
+		sleep_T(Thread* t, Ticks x, unsigned int n)
+			: sleepThread(t), when(x), order(n) {};
 		Thread* sleepThread;
-		int when;
+		Ticks when;		// the tick to wake up at
+		unsigned int order;	// # of naps before it, so those
+					// due together wake in order
 	};
-	int currentINT;
-	std::list<sleep_T> T_list;
+	static bool wakesLater(const sleep_T &x, const sleep_T &y);
+				// the order of the heap
+	void setWakeup();	// schedule the wakeup for the first due
+	std::vector<sleep_T> T_list;
+	unsigned int naps;	// # of naps taken so far
+	InterruptHandle wakeup;	// the wakeup interrupt, if any
 };
 
 class Scheduler {
@@ -57,6 +82,21 @@ class Scheduler {
 	void CheckToBeDestroyed();	// Check if thread that had been
     					// running needs to be deleted
 	void Print();			// Print contents of ready list
+	bool AnyReady() { return !readyList->IsEmpty(); }
+					// Is a thread waiting for the CPU?
+
+	void SetNumCpus(int n);		// Simulate "n" processors
+	int NumCpus() { return numCpus; }
+	bool OnClockCpu();		// Is the processor we are simulating
+					// the one that advances the clock?
+	void CpuTick();			// A user instruction has completed;
+					// take turns with the other processors
+	Thread* IdleCpu();		// Nothing is ready to run; leave this
+					// processor idle, and return the
+					// thread on the next busy one, if any
+	void SetParallel(bool p) { parallel = p; }
+					// Run the processors' turns on host
+					// threads when we can
     	
     	void setSchedulerType(SchedulerType t) {schedulerType = t;}
 	SchedulerType getSchedulerType() {return schedulerType;}
@@ -69,6 +109,24 @@ class Scheduler {
 					// but not running
 	Thread *toBeDestroyed;		// finishing thread to be destroyed
     					// by the next thread that runs
+
+	int numCpus;			// # of processors we simulate
+	int currentCpu;			// the one kernel->currentThread is on
+	Thread *cpuThread[MaxCpus];	// the thread running on each
+					// processor, or NULL if it is idle
+	int sliceLeft[MaxCpus];		// user instructions until each 
+					// processor's timer goes off
+	int quantumLeft;		// user instructions left in the
+					// current processor's turn
+
+	bool parallel;			// see SetParallel
+
+	void NextCpu();			// Give the next processor a turn
+	bool RunParallel(int *stopped);	// Run whole rounds of turns on host
+					// threads, if nothing can interrupt
+					// them
+
+	friend class Checkpoint;	// saves the ready list
 };
 
 #endif // SCHEDULER_H
@@ -25,16 +25,24 @@
 // this is put at the top of the execution stack, for detecting stack overflows
 const int STACK_FENCEPOST = 0xdedbeef;
 
+int Thread::nextId = 0;
+int Thread::numThreads = 0;
+
 //----------------------------------------------------------------------
 // Thread::Thread
 // 	Initialize a thread control block, so that we can then call
 //	Thread::Fork.
 //
 //	"threadName" is an arbitrary string, useful for debugging.
+//	Each thread also gets a number of its own, counting from 0 for
+//	the main thread.
 //----------------------------------------------------------------------
 
 Thread::Thread(char* threadName) {
     name = threadName;
+    id = nextId++;
+    numThreads++;
+    userPreempted = FALSE;
     stackTop = NULL;
     stack = NULL;
     status = JUST_CREATED;
@@ -64,6 +72,7 @@ Thread::~Thread() {
     DEBUG(dbgThread, "Deleting thread: " << name);
 
     ASSERT(this != kernel->currentThread);
+    numThreads--;
     if (stack != NULL)
 	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
 }
@@ -241,8 +250,12 @@ Thread::Sleep (bool finishing) {
     DEBUG(dbgThread, "Sleeping thread: " << name);
 
     status = BLOCKED;
-    while ((nextThread = kernel->scheduler->FindNextToRun()) == NULL)
+    while ((nextThread = kernel->scheduler->FindNextToRun()) == NULL
+	   && (nextThread = kernel->scheduler->IdleCpu()) == NULL) {
+	kernel->alarm->Idling();	// with -tickless, make sure the
+					// timer goes off if nothing else will
 	kernel->interrupt->Idle();	// no one to run, wait for an interrupt
+    }
     
     // returns when it's time for us to run
     kernel->scheduler->Run(nextThread, finishing); 
@@ -108,6 +108,11 @@ class Thread {
     void setPriority(int t)	{priority = t;}
     int getPriority()		{return priority;}
     char* getName() { return (name); }
+    int getId() { return id; }	// unique, in order of creation
+    void setUserPreempted(bool p) { userPreempted = p; }
+				// TRUE while the thread is on the ready
+				// list because the timer preempted it
+				// after a user instruction
     void Print() { cout << name; }
     void SelfTest();		// test whether thread impl is working
 
@@ -119,12 +124,19 @@ class Thread {
                 // (If NULL, don't deallocate stack)
     ThreadStatus status;	// ready, running or blocked
     char* name;
+    int id;
+    bool userPreempted;		// see setUserPreempted
+    static int nextId;		// the id of the next thread created
+    static int numThreads;	// # of threads not yet deleted
     int burstTime;
     int priority;	
     void StackAllocate(VoidFunctionPtr func, void *arg);
                     // Allocate a stack for thread.
                 // Used internally by Fork()
 
+    friend class Checkpoint;	// saves and restores the ids, and
+				// counts the threads
+
 #ifdef USER_PROGRAM
 // A thread running a user program actually has *two* sets of CPU registers -- 
 // one for its state while executing user code, one for its state 
@@ -135,6 +147,8 @@ class Thread {
   public:
     void SaveUserState();		// save user-level register state
     void RestoreUserState();		// restore user-level register state
+    int *UserRegisters() { return userRegisters; }
+					// where SaveUserState saved them
 
     AddrSpace *space;			// User code this thread is running.
 #endif
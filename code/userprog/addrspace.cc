@@ -20,6 +20,9 @@
 #include "addrspace.h"
 #include "machine.h"
 #include "noff.h"
+#include "profile.h"
+#include "sampler.h"
+#include "syscall.h"
 
 //----------------------------------------------------------------------
 // SwapHeader
@@ -31,7 +34,9 @@
 swap_method_t AddrSpace::SwapMethod = FIFO;
 queue<uint32_t> AddrSpace::FreeFrameList = {};
 queue<uint32_t> AddrSpace::FreeSectorList = {};
-bool AddrSpace::usedPhyPage[NumPhysPages] = {0};
+bool *AddrSpace::usedPhyPage = NULL;
+AddrSpace *AddrSpace::asidOwner[NumAsids] = {NULL};
+int AddrSpace::nextAsid = 0;
 
 static void SwapHeader (NoffHeader *noffH) {
     noffH->noffMagic = WordToHost(noffH->noffMagic);
@@ -70,8 +75,16 @@ AddrSpace::AddrSpace() {
         pageTable[i].readOnly = false;  
     }
     
+    profile = NULL;
+    sampler = NULL;
+    asid = -1;				// until we first run (RestoreState)
+    for (int i = 0; i < NumPerfCounters; i++) {
+        perfCount[i] = perfStart[i] = 0;
+    }
+
     // zero out the entire address space
     bzero(kernel->machine->mainMemory, MemorySize);
+    kernel->machine->InvalidateAllFrames();
 }
 
 //----------------------------------------------------------------------
@@ -80,6 +93,10 @@ AddrSpace::AddrSpace() {
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace() {
+    if (asid != -1) {			// the TLB mustn't point at us
+        kernel->machine->tlb->FlushAsid(asid);
+        asidOwner[asid] = NULL;
+    }
     for(uint32_t i = 0; i < numPages; i++)
         AddrSpace::usedPhyPage[pageTable[i].physicalFrame] = false;
     delete pageTable;
@@ -147,6 +164,15 @@ bool AddrSpace::Load(char *fileName) {
             executable->ReadAt(buf, SectorSize, noffH.code.inFileAddr + SectorSize * i);
             kernel->SwapDisk->WriteSector(tmp, buf);
         }
+        kernel->machine->FlushHostTLB();	// pages just became read-only
+    }
+    if (kernel->machine->profiling) {	// kept until Halt, for the report
+        profile = new Profile(fileName, executable, noffH.code.virtualAddr,
+                              noffH.code.size, noffH.code.inFileAddr);
+    }
+    if (Sampler::Sampling()) {		// also kept until Halt
+        sampler = new Sampler(fileName, executable, noffH.code.virtualAddr,
+                              noffH.code.size, noffH.code.inFileAddr);
     }
 
     delete executable;			// close file
@@ -215,12 +241,19 @@ void AddrSpace::InitRegisters() {
 // 	On a context switch, save any machine state, specific
 //	to this address space, that needs saving.
 //
-//	For now, don't need to save anything!
+//	For now, don't need to save anything!  But add what everyone
+//	counted since RestoreState to our performance counts: it was us.
+//	With a TLB, our entries stay in it, tagged with our ASID.
 //----------------------------------------------------------------------
 
 void AddrSpace::SaveState() {
-        pageTable=kernel->machine->pageTable;
-        numPages=kernel->machine->pageTableSize;
+        if (kernel->machine->tlb == NULL) {
+            pageTable=kernel->machine->pageTable;
+            numPages=kernel->machine->pageTableSize;
+        }
+        for (int i = 0; i < NumPerfCounters; i++) {
+            perfCount[i] += GlobalPerfCount(i) - perfStart[i];
+        }
 }
 
 //----------------------------------------------------------------------
@@ -228,10 +261,165 @@ void AddrSpace::SaveState() {
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      For now, tell the machine where to find the page table, and
+//	make it forget the translations it cached from the old one.
+//	With a TLB, the machine never sees the page table: just switch
+//	the TLB to our ASID, so that only our translations match, without
+//	flushing anyone's.
+//	Also tell it where to count our instructions, if profiling, and
+//	note the performance counts as we start to run.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() {
-    kernel->machine->pageTable = pageTable;
-    kernel->machine->pageTableSize = numPages;
+    if (kernel->machine->tlb != NULL) {
+        if (asid == -1) {
+            AssignAsid();
+        }
+        kernel->machine->tlb->SetAsid(asid);
+    } else {
+        kernel->machine->pageTable = pageTable;
+        kernel->machine->pageTableSize = numPages;
+    }
+    kernel->machine->FlushHostTLB();
+    kernel->machine->profile = profile;
+    for (int i = 0; i < NumPerfCounters; i++) {
+        perfStart[i] = GlobalPerfCount(i);
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AssignAsid
+// 	Give us an ASID for the TLB: a free one, if there is one; or
+//	else take the next one round from whoever has it, after throwing
+//	its translations out of the TLB.  They will get another the next
+//	time they run.
+//----------------------------------------------------------------------
+
+void AddrSpace::AssignAsid() {
+    int i;
+
+    for (i = 0; i < NumAsids; i++) {
+        if (asidOwner[(nextAsid + i) % NumAsids] == NULL) {
+            break;
+        }
+    }
+    asid = (nextAsid + i) % NumAsids;	// free, or else nextAsid
+    nextAsid = (asid + 1) % NumAsids;
+    if (asidOwner[asid] != NULL) {
+        DEBUG(dbgAddr, "Taking ASID " << asid << " from another address space");
+        kernel->machine->tlb->FlushAsid(asid);
+        asidOwner[asid]->asid = -1;
+    }
+    asidOwner[asid] = this;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::RefillTLB
+// 	The kernel's TLB miss handler: load the translation of virtual
+//	address "virtAddr" from our page table into the TLB, bringing the
+//	page into memory first if it isn't there (a real page fault).
+//	Called by ExceptionHandler for a PageFaultException, and by the
+//	machine's copy routines for the kernel's own misses.
+//
+//	Returns FALSE if "virtAddr" is not in the address space at all.
+//----------------------------------------------------------------------
+
+bool AddrSpace::RefillTLB(int virtAddr) {
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    TranslationEntry *entry;
+
+    if (vpn >= numPages) {
+        return FALSE;
+    }
+    entry = &pageTable[vpn];
+    if (!entry->valid) {
+        DEBUG(dbgAddr, "Page fault at 0x" << std::hex << virtAddr << std::dec);
+        kernel->stats->numPageFaults++;
+        entry->PageIn();
+    }
+    kernel->machine->tlb->Load(entry);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::GlobalPerfCount
+// 	Return the count of performance counter "counter" (see syscall.h)
+//	for the whole machine, since Nachos started.
+//----------------------------------------------------------------------
+
+Ticks AddrSpace::GlobalPerfCount(int counter) {
+    Statistics *stats = kernel->stats;
+
+    switch (counter) {
+      case PerfInstructions:
+        return stats->numUserInstructions;
+      case PerfUserTicks:
+        return stats->userTicks;
+      case PerfSystemTicks:
+        return stats->systemTicks;
+      case PerfPageFaults:
+        return stats->numPageFaults;
+      case PerfDiskReads:
+        return stats->numDiskReads;
+      case PerfDiskWrites:
+        return stats->numDiskWrites;
+    }
+    ASSERTNOTREACHED();
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PerfCount
+// 	Return our count of performance counter "counter": what we had
+//	counted, and what has been counted since we started running.
+//	Only for the address space that is running.
+//----------------------------------------------------------------------
+
+Ticks AddrSpace::PerfCount(int counter) {
+    return perfCount[counter] + GlobalPerfCount(counter) - perfStart[counter];
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ChargeParallel
+// 	Add to our counts "instrs" user instructions we ran on a host
+//	thread (see Scheduler::RunParallel).  Everyone's counts went up
+//	while we were saved, so SaveState and RestoreState missed them.
+//----------------------------------------------------------------------
+
+void AddrSpace::ChargeParallel(int instrs) {
+    perfCount[PerfInstructions] += instrs;
+    perfCount[PerfUserTicks] += instrs * UserTick;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Checksum
+// 	Return a digest (32-bit FNV-1a) of every byte of the address
+//	space, in virtual address order.  Pages that are in memory are
+//	read from mainMemory, pages that are swapped out are read from
+//	the swap disk, and pages that were never touched count as zeros.
+//
+//	Used to check that two runs of the same program (e.g. with
+//	different instruction interpreters) end in the same state.
+//----------------------------------------------------------------------
+
+unsigned int AddrSpace::Checksum() {
+    unsigned int hash = 2166136261u;
+    char buf[SectorSize];
+    char *page;
+
+    for (uint32_t i = 0; i < numPages; i++) {
+        if (pageTable[i].valid) {
+            page = kernel->machine->mainMemory + pageTable[i].physicalFrame * PageSize;
+        } else if (pageTable[i].diskSector != 0) {
+            kernel->SwapDisk->ReadSector(pageTable[i].diskSector, buf);
+            page = buf;
+        } else {
+            bzero(buf, SectorSize);
+            page = buf;
+        }
+        for (unsigned int j = 0; j < PageSize; j++) {
+            hash = (hash ^ (unsigned char) page[j]) * 16777619u;
+        }
+    }
+    return hash;
 }
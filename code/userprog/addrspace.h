@@ -15,8 +15,13 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "tlb.h"
+#include "syscall.h"
 #include <string.h>
 
+class Profile;
+class Sampler;
+
 #define UserStackSize 1024 	// increase this as necessary!
 
 enum swap_method_t {FIFO, LRU};
@@ -50,7 +55,8 @@ class AddrSpace {
     AddrSpace();			// Create an address space.
     ~AddrSpace();			// De-allocate an address space
 
-    static bool usedPhyPage[NumPhysPages];
+    static bool *usedPhyPage;		// NumPhysPages of them, made with
+					// the Machine
 
     void Execute(char *fileName);	// Run the the program
 					// stored in the file "executable"
@@ -58,10 +64,50 @@ class AddrSpace {
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
 
+    TranslationEntry *PageTable() { return pageTable; }
+    unsigned int NumPages() { return numPages; }
+					// as of the last SaveState
+
+    bool RefillTLB(int virtAddr);	// Load the translation of "virtAddr"
+					// into the TLB, paging it in if need
+					// be; FALSE if it isn't ours
+
+    Sampler *Samples() { return sampler; }
+					// where the timer counts where we
+					// are, with -sample
+
+    unsigned int Checksum();		// Digest of the contents of the
+					// address space, wherever its
+					// pages currently live
+
+    Ticks PerfCount(int counter);	// Our count of "counter" (see
+					// PerfCounter in syscall.h), while
+					// we are running
+    void ChargeParallel(int instrs);	// Count "instrs" user instructions
+					// run on a host thread (-parallel)
+    static Ticks GlobalPerfCount(int counter);
+					// Everyone's count of "counter"
+
   private:
     TranslationEntry *pageTable;	// Assume linear page table translation for now!
     uint32_t numPages;  // Number of pages in the virtual address space
     uint32_t numSectors;// Number of sector in the virtual address space
+    Profile *profile;	// where the simulator counts our instructions,
+			// with -prof
+    Sampler *sampler;	// and where the timer samples us, with -sample
+    Ticks perfCount[NumPerfCounters];	// our counts, up to the last
+					// SaveState,
+    Ticks perfStart[NumPerfCounters];	// and everyone's, as of the
+					// last RestoreState
+    int asid;				// our tag in the TLB, or -1 if we
+					// have none (yet)
+
+    static AddrSpace *asidOwner[NumAsids];
+					// who has each ASID, or NULL
+    static int nextAsid;		// where to look for a free one
+
+    void AssignAsid();			// Get an ASID, taking one from
+					// another space if need be
 
     bool Load(char *fileName);		// Load the program into memory
 					// return false if not found
@@ -69,6 +115,9 @@ class AddrSpace {
     void InitRegisters();		// Initialize user-level CPU registers,
 					// before jumping to user code
 
+    friend class Checkpoint;		// saves and restores the page table
+					// and the free lists
+
 };
 
 #endif // ADDRSPACE_H
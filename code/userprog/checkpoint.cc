@@ -0,0 +1,415 @@
+// checkpoint.cc
+//	Routines to save a run of user programs to a file, and to start
+//	another run from it.  See checkpoint.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "checkpoint.h"
+#include "main.h"
+#include "addrspace.h"
+#include "machine.h"
+#include "synchdisk.h"
+
+// What a checkpoint starts with, to tell whether it is one, and one
+// this nachos can use
+
+const int CheckpointMagic = 0x4e434b50;		// "NCKP"
+
+const int HeaderSize = 8;			// ints (see MakeHeader)
+
+char *Checkpoint::fileName = NULL;
+Ticks Checkpoint::when = NeverDue;
+std::vector<char> Checkpoint::buffer;
+char *Checkpoint::restored = NULL;
+int Checkpoint::size = 0;
+int Checkpoint::position = 0;
+bool Checkpoint::resumed = TRUE;
+Statistics Checkpoint::stats;
+std::vector<Ticks> Checkpoint::timerDue;
+bool Checkpoint::tickStopped = FALSE;
+Ticks Checkpoint::lastTick = 0;
+
+//----------------------------------------------------------------------
+// MakeHeader
+// 	Fill in "header" for this nachos, whose memory and disks may be
+//	any size (nachos -mem, -disk): a checkpoint only fits the same.
+//----------------------------------------------------------------------
+
+static void
+MakeHeader(int *header)
+{
+    int values[HeaderSize] = {
+	CheckpointMagic, (int) NumPhysPages, PageSize, NumSectors, SectorSize,
+	NumTotalRegs, sizeof(Statistics), sizeof(TranslationEntry)
+    };
+
+    bcopy(values, header, sizeof(values));
+}
+
+//----------------------------------------------------------------------
+// Checkpoint::Request
+// 	Arrange to save a checkpoint in "name", as soon as we can after
+//	time "time".
+//----------------------------------------------------------------------
+
+void
+Checkpoint::Request(char *name, Ticks time)
+{
+    ASSERT(time >= 0);
+    fileName = name;
+    when = time;
+}
+
+//----------------------------------------------------------------------
+// Checkpoint::Put, Checkpoint::Get
+// 	Append "size" bytes of "data" to the checkpoint being built; copy
+//	the next "size" bytes of the one being restored into "data".
+//----------------------------------------------------------------------
+
+void
+Checkpoint::Put(const void *data, int size)
+{
+    buffer.insert(buffer.end(), (const char *) data, (const char *) data + size);
+}
+
+void
+Checkpoint::Get(void *data, int count)
+{
+    if (position + count > size) {
+	cerr << "Checkpoint is too short\n";
+	Exit(1);
+    }
+    memcpy(data, restored + position, count);
+    position += count;
+}
+
+//----------------------------------------------------------------------
+// Checkpoint::SafePoint
+// 	Return TRUE if all the state of the run is in places we know how
+//	to save: the current thread has just finished a user instruction
+//	(we are called from Machine::Run), it is the only one not on the
+//	ready list, and everything on the ready list was preempted the
+//	same way; and the only thing that will interrupt is the timer.
+//----------------------------------------------------------------------
+
+bool
+Checkpoint::SafePoint()
+{
+    Scheduler *scheduler = kernel->scheduler;
+    Thread *thread;
+
+    if (scheduler->NumCpus() > 1 || scheduler->toBeDestroyed != NULL
+	|| kernel->currentThread->space == NULL
+	|| Thread::numThreads != 1 + (int) scheduler->readyList->NumInList()
+	|| !kernel->alarm->sleeper.isEmpty()) {
+	return FALSE;
+    }
+    for (ListIterator<Thread *> i(scheduler->readyList); !i.IsDone(); i.Next()) {
+	thread = i.Item();
+	if (!thread->userPreempted || thread->space == NULL) {
+	    return FALSE;
+	}
+    }
+    for (int i = 0; i < kernel->interrupt->NumPending(); i++) {
+	if (kernel->interrupt->Pending(i)->type != TimerInt) {
+	    return FALSE;		// e.g. a disk request in progress
+	}
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Checkpoint::Take
+// 	If it is safe to, save everything in the checkpoint file.  If
+//	not, we will be called again after the next user instruction.
+//----------------------------------------------------------------------
+
+void
+Checkpoint::Take()
+{
+    Machine *machine = kernel->machine;
+    std::vector<Thread *> threads;
+    std::queue<uint32_t> frames = AddrSpace::FreeFrameList;
+    std::queue<uint32_t> sectors = AddrSpace::FreeSectorList;
+    std::vector<SynchDisk *> disks;
+    int header[HeaderSize];
+    int count, value, fd;
+
+    if (!SafePoint()) {
+	return;
+    }
+    kernel->currentThread->SaveUserState();	// so all threads look alike
+    kernel->currentThread->space->SaveState();
+    threads.push_back(kernel->currentThread);	// runs first
+    for (ListIterator<Thread *> i(kernel->scheduler->readyList);
+	 !i.IsDone(); i.Next()) {
+	threads.push_back(i.Item());
+    }
+
+    buffer.clear();
+    MakeHeader(header);
+    Put(header, sizeof(header));
+    Put(kernel->stats, sizeof(Statistics));
+
+    count = kernel->interrupt->NumPending();
+    Put(&count, sizeof(int));
+    for (int i = 0; i < count; i++) {
+	Put(&kernel->interrupt->Pending(i)->when, sizeof(Ticks));
+    }
+    Put(&kernel->alarm->stopped, sizeof(bool));
+    Put(&kernel->alarm->lastTick, sizeof(Ticks));
+    Put(&Thread::nextId, sizeof(int));
+
+    // paging
+    Put(&TranslationEntry::MaxID, sizeof(uint32_t));
+    Put(&TranslationEntry::LastSwapIn, sizeof(uint32_t));
+    Put(&TranslationEntry::LastSwapOut, sizeof(uint32_t));
+    Put(AddrSpace::usedPhyPage, NumPhysPages * sizeof(bool));
+    count = frames.size();
+    Put(&count, sizeof(int));
+    for (; !frames.empty(); frames.pop()) {
+	Put(&frames.front(), sizeof(uint32_t));
+    }
+    count = sectors.size();
+    Put(&count, sizeof(int));
+    for (; !sectors.empty(); sectors.pop()) {
+	Put(&sectors.front(), sizeof(uint32_t));
+    }
+
+    // threads, and their address spaces, with the latest use and dirty
+    // bits (the TLB itself is not saved)
+    if (machine->tlb != NULL) {
+	machine->tlb->WriteBack();
+    }
+    count = threads.size();
+    Put(&count, sizeof(int));
+    for (unsigned int t = 0; t < threads.size(); t++) {
+	Thread *thread = threads[t];
+	AddrSpace *space = thread->space;
+
+	value = strlen(thread->getName());
+	Put(&value, sizeof(int));
+	Put(thread->getName(), value);
+	Put(&thread->id, sizeof(int));
+	value = thread->getPriority();
+	Put(&value, sizeof(int));
+	value = thread->getBurstTime();
+	Put(&value, sizeof(int));
+	Put(thread->UserRegisters(), NumTotalRegs * sizeof(int));
+	Put(&space->numPages, sizeof(uint32_t));
+	Put(&space->numSectors, sizeof(uint32_t));
+	Put(space->pageTable, space->numPages * sizeof(TranslationEntry));
+    }
+
+    Put(machine->mainMemory, MemorySize);
+
+    // which page of which thread is in each frame
+    for (unsigned int f = 0; f < NumPhysPages; f++) {
+	TranslationEntry *entry = machine->ReverseTable[f]->entry;
+	int owner = -1, page = 0;
+
+	for (unsigned int t = 0; t < threads.size() && entry != NULL; t++) {
+	    AddrSpace *space = threads[t]->space;
+
+	    if (entry >= space->pageTable
+		&& entry < space->pageTable + space->numPages) {
+		owner = t;
+		page = entry - space->pageTable;
+		break;
+	    }
+	}
+	Put(&owner, sizeof(int));
+	Put(&page, sizeof(int));
+    }
+
+    // the disks
+    disks.push_back(kernel->SwapDisk);
+#ifdef FILESYS
+    disks.push_back(kernel->synchDisk);
+#endif
+    for (unsigned int d = 0; d < disks.size(); d++) {
+	Disk *disk = disks[d]->disk;
+
+	Put(&disk->lastSector, sizeof(int));
+	Put(&disk->bufferInit, sizeof(Ticks));
+	value = buffer.size();		// read straight into the buffer;
+	buffer.resize(value + NumSectors * SectorSize);	// we're on a
+	Lseek(disk->fileno, MagicSize, 0);		// small stack
+	Read(disk->fileno, &buffer[value], NumSectors * SectorSize);
+    }
+
+    fd = OpenForWrite(fileName);
+    WriteFile(fd, &buffer[0], buffer.size());	// all at once
+    Close(fd);
+    cout << "Checkpoint saved in " << fileName << " at tick "
+	 << kernel->stats->totalTicks << ", " << buffer.size() << " bytes\n";
+    buffer.clear();
+    when = NeverDue;
+}
+
+//----------------------------------------------------------------------
+// Checkpoint::Restore
+// 	Put back everything a checkpoint saved, and fork a thread for
+//	each program in it, in the order they were to run.  Each starts
+//	in Resume; the first of them to run sets the clock.
+//
+//	Called by UserProgKernel::Run, instead of starting the programs
+//	given with -e.
+//----------------------------------------------------------------------
+
+void
+Checkpoint::Restore(char *name)
+{
+    Machine *machine = kernel->machine;
+    int header[HeaderSize], expected[HeaderSize];
+    std::vector<Thread *> threads;
+    std::vector<SynchDisk *> disks;
+    uint32_t number;
+    int count, value, nextId;
+
+    restored = MapFile(name, &size);
+    if (restored == NULL) {
+	cerr << "Unable to open checkpoint " << name << "\n";
+	Exit(1);
+    }
+    position = 0;
+    Get(header, sizeof(header));
+    MakeHeader(expected);
+    if (memcmp(header, expected, sizeof(header)) != 0) {
+	cerr << name << " is not a checkpoint of this Nachos\n";
+	Exit(1);
+    }
+    Get(&stats, sizeof(Statistics));
+
+    Get(&count, sizeof(int));
+    ASSERT(count <= 1);			// there is only the one timer
+    timerDue.resize(count);
+    for (int i = 0; i < count; i++) {
+	Get(&timerDue[i], sizeof(Ticks));
+    }
+    Get(&tickStopped, sizeof(bool));
+    Get(&lastTick, sizeof(Ticks));
+    Get(&nextId, sizeof(int));
+
+    // paging
+    Get(&TranslationEntry::MaxID, sizeof(uint32_t));
+    Get(&TranslationEntry::LastSwapIn, sizeof(uint32_t));
+    Get(&TranslationEntry::LastSwapOut, sizeof(uint32_t));
+    Get(AddrSpace::usedPhyPage, NumPhysPages * sizeof(bool));
+    AddrSpace::FreeFrameList = std::queue<uint32_t>();
+    Get(&count, sizeof(int));
+    for (int i = 0; i < count; i++) {
+	Get(&number, sizeof(uint32_t));
+	AddrSpace::PushFreeFrame(number);
+    }
+    AddrSpace::FreeSectorList = std::queue<uint32_t>();
+    Get(&count, sizeof(int));
+    for (int i = 0; i < count; i++) {
+	Get(&number, sizeof(uint32_t));
+	AddrSpace::PushFreeSector(number);
+    }
+
+    // threads; making their address spaces clears main memory, so
+    // we fill it in after
+    Get(&count, sizeof(int));
+    for (int t = 0; t < count; t++) {
+	Thread *thread;
+	AddrSpace *space;
+	char *threadName;
+
+	Get(&value, sizeof(int));
+	threadName = new char[value + 1];	// kept as long as the thread
+	Get(threadName, value);
+	threadName[value] = '\0';
+	thread = new Thread(threadName);
+	Get(&thread->id, sizeof(int));
+	Get(&value, sizeof(int));
+	thread->setPriority(value);
+	Get(&value, sizeof(int));
+	thread->setBurstTime(value);
+	Get(thread->UserRegisters(), NumTotalRegs * sizeof(int));
+	thread->space = space = new AddrSpace();
+	Get(&space->numPages, sizeof(uint32_t));
+	Get(&space->numSectors, sizeof(uint32_t));
+	ASSERT(space->numPages <= 2 * NumPhysPages);
+	Get(space->pageTable, space->numPages * sizeof(TranslationEntry));
+	threads.push_back(thread);
+    }
+    Thread::nextId = nextId;
+    Get(machine->mainMemory, MemorySize);
+    machine->InvalidateAllFrames();
+
+    for (unsigned int f = 0; f < NumPhysPages; f++) {
+	int owner, page;
+
+	Get(&owner, sizeof(int));
+	Get(&page, sizeof(int));
+	if (owner == -1) {
+	    machine->ReverseTable[f]->entry = NULL;
+	} else {
+	    ASSERT(owner < (int) threads.size());
+	    machine->ReverseTable[f]->entry = &threads[owner]->space->pageTable[page];
+	}
+    }
+
+    // the disks
+    disks.push_back(kernel->SwapDisk);
+#ifdef FILESYS
+    disks.push_back(kernel->synchDisk);
+#endif
+    for (unsigned int d = 0; d < disks.size(); d++) {
+	Disk *disk = disks[d]->disk;
+
+	Get(&disk->lastSector, sizeof(int));
+	Get(&disk->bufferInit, sizeof(Ticks));
+	if (position + NumSectors * SectorSize > size) {
+	    cerr << "Checkpoint is too short\n";
+	    Exit(1);
+	}
+	Lseek(disk->fileno, MagicSize, 0);
+	WriteFile(disk->fileno, restored + position, NumSectors * SectorSize);
+	position += NumSectors * SectorSize;
+    }
+    UnmapFile(restored, size);
+    restored = NULL;
+
+    resumed = FALSE;
+    for (unsigned int t = 0; t < threads.size(); t++) {
+	threads[t]->Fork((VoidFunctionPtr) &Checkpoint::Resume,
+			 (void *) threads[t]);
+    }
+    cout << "Restored " << threads.size() << " threads from " << name
+	 << ", at tick " << stats.totalTicks << "\n";
+}
+
+//----------------------------------------------------------------------
+// Checkpoint::Resume
+// 	Go back to running the user program of a restored thread.  The
+//	first one to run also sets the clock, and the timer, to what
+//	they were when the checkpoint was taken -- nothing else runs
+//	between here and its next user instruction.
+//----------------------------------------------------------------------
+
+void
+Checkpoint::Resume(Thread *thread)
+{
+    Interrupt *interrupt = kernel->interrupt;
+
+    if (!resumed) {
+	resumed = TRUE;
+	*kernel->stats = stats;
+	interrupt->CancelAll();
+	kernel->alarm->stopped = tickStopped;
+	kernel->alarm->lastTick = lastTick;
+	if (!timerDue.empty()) {
+	    kernel->alarm->timer->Reprogram(timerDue[0] - stats.totalTicks);
+	}
+    }
+    thread->RestoreUserState();
+    thread->space->RestoreState();
+    kernel->machine->Run();
+    ASSERTNOTREACHED();
+}
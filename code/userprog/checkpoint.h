@@ -0,0 +1,78 @@
+// checkpoint.h
+//	Routines to save the whole state of a run of user programs in a
+//	file, and to start another run from it (nachos -checkpoint and
+//	-restore).
+//
+//	A checkpoint holds the statistics, the user registers, main
+//	memory, the page table of every program, the reverse page table,
+//	the free frame and free sector queues, the pending interrupts,
+//	the threads (name, id, priority, burst time, registers) in the
+//	order they will run, and the contents of the disks.  It is built
+//	in memory and written with one write; -restore maps the file in
+//	and copies it out.
+//
+//	Only the user state of a thread can be saved, not a kernel stack,
+//	so we wait until the checkpoint can be taken safely: after a user
+//	instruction, on one processor, when every other thread is on the
+//	ready list because it was preempted after a user instruction too,
+//	the disk is idle and no thread is sleeping.  Each thread then
+//	restarts by going straight back to its user program.
+//
+//	A checkpoint is only good for the same nachos binary: it is a
+//	copy of the host's data, in the host's byte order.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "thread.h"
+#include "stats.h"
+#include <vector>
+
+class Checkpoint {
+  public:
+    static void Request(char *fileName, Ticks when);
+				// Save a checkpoint in "fileName" at the
+				// first safe point at or after time "when"
+    static Ticks When() { return when; }
+				// The time it is due, or NeverDue;
+				// checked by Machine::Run after each
+				// user instruction
+    static void Take();		// Save it, if this is a safe point
+
+    static void Restore(char *fileName);
+				// Re-create the state saved in "fileName",
+				// and queue the threads to resume
+
+  private:
+    static bool SafePoint();	// Can we save everything now?
+    static void Put(const void *data, int size);
+				// Append to the checkpoint being built
+    static void Get(void *data, int size);
+				// Copy out of the one being restored
+    static void Resume(Thread *thread);
+				// The first thing a restored thread runs
+
+    static char *fileName;	// where to save the checkpoint
+    static Ticks when;		// when to, or NeverDue
+    static std::vector<char> buffer;
+				// the checkpoint being built
+    static char *restored;	// the checkpoint being restored, mapped
+    static int size;		//   its size
+    static int position;	//   and how far we have read it
+
+    static bool resumed;	// TRUE once the first restored thread
+				// has set the clock and the interrupts:
+    static Statistics stats;	// the statistics to start from
+    static std::vector<Ticks> timerDue;
+				// when the timer interrupts were due
+    static bool tickStopped;	// whether the ticks were stopped
+    static Ticks lastTick;	//   (-tickless), and when the last was
+};
+
+#endif // CHECKPOINT_H
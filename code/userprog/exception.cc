@@ -50,7 +50,9 @@
 
 void ExceptionHandler(ExceptionType which) {
 	int	type = kernel->machine->ReadRegister(2);
-	int	val, valR, valL, my_val = 0, strlen = 0;
+	int	val, valR, valL, strlen = 0;
+	int	len, i;
+	char	str[PageSize];
 
     switch (which) {
 	case SyscallException:
@@ -79,7 +81,7 @@ void ExceptionHandler(ExceptionType which) {
 
 		case SC_Sleep:
 			val=kernel->machine->ReadRegister(4);
-			cout << "Sleep Time:" << val << "ms" << endl;
+			cout << "Sleep Time:" << val << " ticks" << endl;
 			kernel->alarm->WaitUntil(val);
 			return;
 
@@ -128,16 +130,34 @@ void ExceptionHandler(ExceptionType which) {
 			kernel->machine->WriteRegister(2, valR % valL);
 			return;
 
+		case SC_PerfCounter:
+			val=kernel->machine->ReadRegister(4);
+			valR=kernel->machine->ReadRegister(5);
+			if (val < 0 || val >= NumPerfCounters) {
+				val = -1;
+			} else if (valR == PerfGlobal) {	// the low 32 bits
+				val = (int) AddrSpace::GlobalPerfCount(val);
+			} else if (valR == PerfProcess) {
+				val = (int) kernel->currentThread->space->PerfCount(val);
+			} else {
+				val = -1;
+			}
+			kernel->machine->WriteRegister(2, val);
+			return;
+
 		case SC_PtrStr:
 			strlen = 0;
 			val=kernel->machine->ReadRegister(4);
-			kernel->machine->ReadMem(val++, 1, &my_val);
 			cout << "[B11015037_Print]";
-			while(my_val != 0 && val != (int)nullptr){
-				strlen++;
-				cout << ( ('A'+11 == my_val || 'a'+11 == my_val) ? '*' : (char)my_val);
-				kernel->machine->ReadMem(val++, 1, &my_val);
-			}
+			do {	// a chunk at a time, however long the string is;
+				// on a bad page (len is -1) print what we got, and stop
+				len = kernel->machine->CopyStringIn(val, str, sizeof(str));
+				for (i = 0; str[i] != '\0'; i++) {
+					cout << ( ('A'+11 == str[i] || 'a'+11 == str[i]) ? '*' : str[i]);
+				}
+				strlen += i;
+				val += i;
+			} while (len == sizeof(str) - 1);
 			kernel->machine->WriteRegister(2, strlen);
 			return;
 
@@ -145,6 +165,12 @@ void ExceptionHandler(ExceptionType which) {
 			DEBUG(dbgAddr, "Program exit\n");
 			val=kernel->machine->ReadRegister(4);
 			cout << "return value:" << val << endl;
+			if (debug->IsEnabled(dbgState)) {
+				kernel->machine->DumpState();
+				cout << "Address space digest: 0x" << std::hex
+				     << kernel->currentThread->space->Checksum()
+				     << std::dec << endl;
+			}
 			kernel->currentThread->Finish();
 			break;
 		default:
@@ -153,6 +179,13 @@ void ExceptionHandler(ExceptionType which) {
 	    }
 	    break;
 	case PageFaultException:
+		// with a TLB, usually just a miss: load the translation,
+		// and let the instruction try again
+		if (kernel->machine->tlb != NULL
+		    && kernel->currentThread->space->RefillTLB(
+				kernel->machine->ReadRegister(BadVAddrReg))) {
+			return;
+		}
 		cerr << "Page Fault" << "\n";
 	    break;
 	case AddressErrorException:
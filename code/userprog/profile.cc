@@ -0,0 +1,247 @@
+// profile.cc
+//	Routines to profile user programs, by PC, and to print a report
+//	of where they spent their time at Halt.  See profile.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "profile.h"
+#include "mipssim.h"
+#include "main.h"
+#include <algorithm>
+#include <iomanip>
+
+std::vector<Profile *> Profile::all;
+
+char Profile::opKind[MaxOpcode + 1];
+
+//----------------------------------------------------------------------
+// Profile::Profile
+// 	Start profiling a program that has just been loaded: keep a
+//	decoded copy of its code, to find its basic blocks, read its
+//	symbols, if coff2noff saved them, and zero the counts.
+//
+//	"fileName" -- the program's NOFF file
+//	"executable" -- the file, open
+//	"codeAddr", "codeSize", "inFileAddr" -- where its code is, in
+//		the address space and in the file (see noff.h)
+//----------------------------------------------------------------------
+
+Profile::Profile(char *fileName, OpenFile *executable, int codeAddr,
+		 int codeSize, int inFileAddr)
+{
+    unsigned int *words;
+
+    if (opKind[OP_LW] == OtherOp) {		// first time: fill it in
+	opKind[OP_LB] = opKind[OP_LBU] = opKind[OP_LH] = opKind[OP_LHU] =
+	    opKind[OP_LW] = opKind[OP_LWL] = opKind[OP_LWR] = LoadOp;
+	opKind[OP_SB] = opKind[OP_SH] = opKind[OP_SW] = opKind[OP_SWL] =
+	    opKind[OP_SWR] = StoreOp;
+	opKind[OP_BEQ] = opKind[OP_BGEZ] = opKind[OP_BGEZAL] =
+	    opKind[OP_BGTZ] = opKind[OP_BLEZ] = opKind[OP_BLTZ] =
+	    opKind[OP_BLTZAL] = opKind[OP_BNE] = opKind[OP_J] =
+	    opKind[OP_JAL] = opKind[OP_JALR] = opKind[OP_JR] = BranchOp;
+    }
+
+    name = fileName;
+    this->codeAddr = codeAddr;
+    numInstrs = codeSize / 4;
+    code = new Instruction[numInstrs];
+    counts = new ProfileCounts[numInstrs];
+    words = new unsigned int[numInstrs];
+    executable->ReadAt((char *) words, numInstrs * 4, inFileAddr);
+    for (unsigned int i = 0; i < numInstrs; i++) {
+	code[i].value = WordToHost(words[i]);
+	code[i].Decode();
+	counts[i].executed = counts[i].loads = counts[i].stores
+	    = counts[i].taken = 0;
+    }
+    delete [] words;
+
+    symbols.Read(fileName);
+
+    all.push_back(this);
+}
+
+//----------------------------------------------------------------------
+// Profile::~Profile
+//----------------------------------------------------------------------
+
+Profile::~Profile()
+{
+    delete [] code;
+    delete [] counts;
+}
+
+//----------------------------------------------------------------------
+// Profile::Target
+// 	Return the address the branch or jump code[i] goes to, if taken;
+//	-1 for a jump to a register.
+//----------------------------------------------------------------------
+
+int
+Profile::Target(int i)
+{
+    int pc = codeAddr + i * 4;
+
+    switch (code[i].opCode) {
+      case OP_J:
+      case OP_JAL:
+	return ((pc + 8) & 0xf0000000) | IndexToAddr(code[i].extra);
+      case OP_JR:
+      case OP_JALR:
+	return -1;
+      default:
+	return pc + 4 + IndexToAddr(code[i].extra);
+    }
+}
+
+//----------------------------------------------------------------------
+// Profile::Print
+// 	Print the report for this program: totals, the functions that
+//	completed the most instructions, and the basic blocks that did.
+//
+//	Basic blocks are found from the code: one starts at each function,
+//	at each place a branch or jump can go, and after each branch's
+//	delay slot.  (Calls through registers and returns are only ends
+//	of blocks, as we can't tell where they go.)  A block's count is
+//	how many times its first instruction ran.
+//----------------------------------------------------------------------
+
+// One line of the report: a function or a block, and its totals
+
+class ProfileLine {
+  public:
+    int start;			// address of the function or block
+    int instrs;			// # of instructions in a block
+    unsigned int count;		// # of times a block ran
+    ProfileCounts total;	// added up over its instructions
+    bool operator<(const ProfileLine &l) const
+	{ return total.executed > l.total.executed; }	// hottest first
+};
+
+static void
+AddCounts(ProfileCounts *total, ProfileCounts *counts)
+{
+    total->executed += counts->executed;
+    total->loads += counts->loads;
+    total->stores += counts->stores;
+    total->taken += counts->taken;
+}
+
+void
+Profile::Print()
+{
+    std::vector<ProfileLine> functions, blocks;
+    std::vector<bool> leader(numInstrs + 1, FALSE);
+    ProfileLine line;
+    ProfileCounts total = {0, 0, 0, 0};
+    unsigned int i, j;
+    int s, target;
+
+    for (i = 0; i < numInstrs; i++) {
+	AddCounts(&total, &counts[i]);
+    }
+    cout << "\nProfile of " << name << ": " << total.executed
+	 << " instructions, " << total.loads << " loads, " << total.stores
+	 << " stores, " << total.taken << " taken branches\n";
+    if (total.executed == 0) {
+	return;
+    }
+
+    // by function; instructions before the first one go under "0x0"
+    for (i = 0; i < numInstrs; i++) {
+	s = symbols.Find(codeAddr + i * 4);
+	if (functions.empty()
+	    || functions.back().start != (s == -1 ? codeAddr : symbols.Address(s))) {
+	    line.start = (s == -1) ? codeAddr : symbols.Address(s);
+	    line.total.executed = line.total.loads = line.total.stores
+		= line.total.taken = 0;
+	    functions.push_back(line);
+	}
+	AddCounts(&functions.back().total, &counts[i]);
+    }
+    std::stable_sort(functions.begin(), functions.end());
+    cout << "Hot functions:\n";
+    cout << std::setw(12) << "instrs" << std::setw(7) << "%"
+	 << std::setw(10) << "loads" << std::setw(10) << "stores"
+	 << std::setw(10) << "taken" << "  function\n";
+    for (i = 0; i < functions.size() && i < (unsigned) ProfileTop
+		&& functions[i].total.executed > 0; i++) {
+	cout << std::setw(12) << functions[i].total.executed
+	     << std::setw(7) << std::fixed << std::setprecision(1)
+	     << 100.0 * functions[i].total.executed / total.executed
+	     << std::setw(10) << functions[i].total.loads
+	     << std::setw(10) << functions[i].total.stores
+	     << std::setw(10) << functions[i].total.taken << "  ";
+	cout << symbols.AddressName(functions[i].start) << "\n";
+    }
+
+    // by basic block
+    leader[0] = TRUE;
+    for (i = 0; i < (unsigned) symbols.NumSymbols(); i++) {
+	j = (unsigned) (symbols.Address(i) - codeAddr) / 4;
+	if (j < numInstrs) {
+	    leader[j] = TRUE;
+	}
+    }
+    for (i = 0; i < numInstrs; i++) {
+	if (opKind[(int) code[i].opCode] == BranchOp) {
+	    if (i + 2 <= numInstrs) {
+		leader[i + 2] = TRUE;		// after the delay slot
+	    }
+	    target = Target(i);
+	    j = (unsigned) (target - codeAddr) / 4;
+	    if (target != -1 && j < numInstrs) {
+		leader[j] = TRUE;
+	    }
+	}
+    }
+    for (i = 0; i < numInstrs; i++) {
+	if (leader[i]) {
+	    line.start = codeAddr + i * 4;
+	    line.instrs = 0;
+	    line.count = counts[i].executed;
+	    line.total.executed = line.total.loads = line.total.stores
+		= line.total.taken = 0;
+	    blocks.push_back(line);
+	}
+	blocks.back().instrs++;
+	AddCounts(&blocks.back().total, &counts[i]);
+    }
+    std::stable_sort(blocks.begin(), blocks.end());
+    cout << "Hot basic blocks:\n";
+    cout << std::setw(12) << "instrs" << std::setw(7) << "%"
+	 << std::setw(10) << "count" << std::setw(10) << "length"
+	 << std::setw(10) << "address" << "  where\n";
+    for (i = 0; i < blocks.size() && i < (unsigned) ProfileTop
+		&& blocks[i].total.executed > 0; i++) {
+	cout << std::setw(12) << blocks[i].total.executed
+	     << std::setw(7) << std::fixed << std::setprecision(1)
+	     << 100.0 * blocks[i].total.executed / total.executed
+	     << std::setw(10) << blocks[i].count
+	     << std::setw(10) << blocks[i].instrs
+	     << "    0x" << std::hex << std::setw(4) << std::setfill('0')
+	     << blocks[i].start << std::setfill(' ') << std::dec << "  ";
+	cout << symbols.AddressName(blocks[i].start) << "\n";
+    }
+    cout.unsetf(std::ios::floatfield);
+    cout << std::setprecision(6);
+}
+
+//----------------------------------------------------------------------
+// Profile::PrintAll
+// 	Print the report for every program we profiled, in the order
+//	they were loaded.  Called at Halt.
+//----------------------------------------------------------------------
+
+void
+Profile::PrintAll()
+{
+    for (unsigned int i = 0; i < all.size(); i++) {
+	all[i]->Print();
+    }
+}
@@ -0,0 +1,93 @@
+// profile.h
+//	Data structures for profiling user programs (nachos -prof).
+//
+//	For every instruction of a user program that completes, the
+//	simulator counts, by PC, how many times it ran, and whether it
+//	was a load, a store, or a branch or jump that was taken (see
+//	Machine::OneInstruction).  At Halt, the counts are added up by
+//	function and by basic block, and the hottest of each printed.
+//
+//	Functions are named using the symbol table of the program (see
+//	symbols.h).
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "machine.h"
+#include "openfile.h"
+#include "symbols.h"
+#include <vector>
+#include <string>
+
+const int ProfileTop = 10;	// # of functions, and of basic blocks,
+				// in each part of the report
+
+// What we count for each instruction of a program
+
+class ProfileCounts {
+  public:
+    unsigned int executed;	// # of times it completed
+    unsigned int loads;		// # of those that were loads
+    unsigned int stores;	//   stores
+    unsigned int taken;		//   taken branches and jumps
+};
+
+// The profile of one program.  One is made each time a program is
+// loaded, and kept until Halt, even if the program exits first.
+
+class Profile {
+  public:
+    Profile(char *fileName, OpenFile *executable, int codeAddr,
+	    int codeSize, int inFileAddr);
+				// Start profiling the program in
+				// "fileName", whose code is at "codeAddr"
+    ~Profile();
+
+    void Count(int pc, Instruction *instr, int nextPC) {
+	unsigned int i = (unsigned) (pc - codeAddr) / 4;
+
+	if (i < numInstrs) {
+	    counts[i].executed++;
+	    if (opKind[(int) instr->opCode] == LoadOp) {
+		counts[i].loads++;
+	    } else if (opKind[(int) instr->opCode] == StoreOp) {
+		counts[i].stores++;
+	    } else if (opKind[(int) instr->opCode] == BranchOp
+		       && nextPC != pc + 8) {
+		counts[i].taken++;
+	    }
+	}
+    }				// The instruction "instr" at "pc" has
+				// completed, and the next one after its
+				// delay slot is at "nextPC"
+
+    void Print();		// Print the report for this program
+
+    static void PrintAll();	// Print the reports for every program,
+				// at Halt
+
+  private:
+    enum OpKind { OtherOp, LoadOp, StoreOp, BranchOp };
+    static char opKind[];	// the OpKind of each opcode; see mips.h
+
+    int Target(int i);		// Where the branch or jump at code[i]
+				// goes, or -1 if we can't tell
+
+    std::string name;		// the program's file name
+    int codeAddr;		// virtual address of its first instruction
+    unsigned int numInstrs;	// # of instructions in its code
+    Instruction *code;		// its code, decoded
+    ProfileCounts *counts;	// what we counted, for each instruction
+    SymbolTable symbols;	// its functions
+
+    static std::vector<Profile *> all;
+				// every profile made, for PrintAll
+};
+
+#endif // PROFILE_H
@@ -0,0 +1,256 @@
+// sampler.cc
+//	Routines to sample where user programs are, on timer interrupts,
+//	and to write out the folded stacks at Halt.  See sampler.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "sampler.h"
+#include "mipssim.h"
+#include "main.h"
+#include "sysdep.h"
+
+char *Sampler::outFileName = NULL;
+int Sampler::every = 1;
+int Sampler::ticks = 0;
+std::vector<Sampler *> Sampler::all;
+
+//----------------------------------------------------------------------
+// Sampler::Sampler
+// 	Start sampling a program that has just been loaded: keep a
+//	decoded copy of its code, to find its prologues, and read its
+//	symbols, if coff2noff saved them.
+//
+//	"fileName" -- the program's NOFF file
+//	"executable" -- the file, open
+//	"codeAddr", "codeSize", "inFileAddr" -- where its code is, in
+//		the address space and in the file (see noff.h)
+//----------------------------------------------------------------------
+
+Sampler::Sampler(char *fileName, OpenFile *executable, int codeAddr,
+		 int codeSize, int inFileAddr)
+{
+    unsigned int *words;
+
+    name = fileName;
+    this->codeAddr = codeAddr;
+    numInstrs = codeSize / 4;
+    code = new Instruction[numInstrs];
+    words = new unsigned int[numInstrs];
+    executable->ReadAt((char *) words, numInstrs * 4, inFileAddr);
+    for (unsigned int i = 0; i < numInstrs; i++) {
+	code[i].value = WordToHost(words[i]);
+	code[i].Decode();
+    }
+    delete [] words;
+
+    symbols.Read(fileName);
+    all.push_back(this);
+}
+
+//----------------------------------------------------------------------
+// Sampler::~Sampler
+//----------------------------------------------------------------------
+
+Sampler::~Sampler()
+{
+    delete [] code;
+}
+
+//----------------------------------------------------------------------
+// Sampler::Start
+// 	Turn on sampling: programs loaded from now on are sampled.
+//
+//	"outFileName" -- where to write the folded stacks, at Halt
+//	"every" -- take a sample every this many timer interrupts
+//----------------------------------------------------------------------
+
+void
+Sampler::Start(char *outFileName, int every)
+{
+    ASSERT(every >= 1);
+    Sampler::outFileName = outFileName;
+    Sampler::every = every;
+}
+
+//----------------------------------------------------------------------
+// Sampler::Tick
+// 	Called by Alarm::CallBack when the timer interrupts a user
+//	program.  Every "every" times, take a sample of the program
+//	running, if it is being sampled.
+//----------------------------------------------------------------------
+
+void
+Sampler::Tick()
+{
+    AddrSpace *space = kernel->currentThread->space;
+    Machine *machine = kernel->machine;
+
+    if (++ticks < every) {
+	return;
+    }
+    ticks = 0;
+    if (space != NULL && space->Samples() != NULL) {
+	space->Samples()->Sample(machine->ReadRegister(PCReg),
+				 machine->ReadRegister(StackReg),
+				 machine->ReadRegister(RetAddrReg));
+    }
+}
+
+//----------------------------------------------------------------------
+// Sampler::ReadWord
+// 	Read the word at "virtAddr" of the running program, through its
+//	page table, into "value".  Return FALSE if it isn't there, or
+//	isn't in memory: we mustn't change anything by looking.
+//----------------------------------------------------------------------
+
+bool
+Sampler::ReadWord(int virtAddr, int *value)
+{
+    AddrSpace *space = kernel->currentThread->space;
+    TranslationEntry *entry;
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+
+    if ((virtAddr & 3) != 0 || vpn >= space->NumPages()) {
+	return FALSE;
+    }
+    entry = &space->PageTable()[vpn];
+    if (!entry->valid) {
+	return FALSE;
+    }
+    *value = WordToHost(*(unsigned int *) &kernel->machine->mainMemory[
+			    entry->physicalFrame * PageSize
+			    + (unsigned) virtAddr % PageSize]);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Sampler::FunctionStart
+// 	Return the index of the first instruction of the function that
+//	code[i] is in.  Use the symbols if we have them; otherwise, look
+//	back for the end of the function before (jr ra, and its delay
+//	slot) or a prologue (addiu sp,sp,-N), whichever comes first.
+//----------------------------------------------------------------------
+
+int
+Sampler::FunctionStart(int i)
+{
+    int s = symbols.Find(codeAddr + i * 4);
+    Instruction *instr;
+
+    if (s != -1) {
+	return (symbols.Address(s) - codeAddr) / 4;
+    }
+    for (int j = i - 1; j >= 0 && j >= i - MaxFunctionSearch; j--) {
+	instr = &code[j];
+	if (instr->opCode == OP_JR && instr->rs == RetAddrReg) {
+	    return min(j + 2, i);
+	}
+	if (instr->opCode == OP_ADDIU && instr->rs == StackReg
+	    && instr->rt == StackReg && instr->extra < 0) {
+	    return j;
+	}
+    }
+    return max(i - MaxFunctionSearch, 0);
+}
+
+//----------------------------------------------------------------------
+// Sampler::Sample
+// 	Follow the chain of calls back from "pc", and count it.
+//
+//	For each function, look at the part of its prologue that has
+//	run: the size of its frame tells us where the caller's stack
+//	pointer was, and where it saved r31, the caller's PC.  A function
+//	that hasn't saved r31 must be the one that was interrupted (its
+//	callers all called something), and the caller's PC is still in
+//	r31.  We stop at a return address of 0 (as __start's is), or
+//	one outside the code, or when we can't read the stack.
+//
+//	"pc", "sp", "ra" -- the program's registers when the timer went
+//		off
+//----------------------------------------------------------------------
+
+void
+Sampler::Sample(int pc, int sp, int ra)
+{
+    std::vector<int> chain;	// the functions, innermost first
+    int i, start, frameSize, raOffset, s;
+    Instruction *instr;
+
+    while ((int) chain.size() < MaxSampleDepth) {
+	i = (pc - codeAddr) / 4;
+	if (pc < codeAddr || i >= (int) numInstrs) {
+	    break;
+	}
+	start = FunctionStart(i);
+	s = symbols.Find(pc);
+	chain.push_back(s == -1 ? codeAddr + start * 4 : symbols.Address(s));
+
+	frameSize = 0;
+	raOffset = -1;
+	for (int j = start; j < i && j < start + MaxPrologue; j++) {
+	    instr = &code[j];
+	    if (instr->opCode == OP_ADDIU && instr->rs == StackReg
+		&& instr->rt == StackReg && instr->extra < 0 && frameSize == 0) {
+		frameSize = -instr->extra;
+	    } else if (instr->opCode == OP_SW && instr->rs == StackReg
+		       && instr->rt == RetAddrReg && raOffset == -1) {
+		raOffset = instr->extra;
+	    }
+	}
+	if (raOffset != -1) {
+	    if (!ReadWord(sp + raOffset, &ra)) {
+		break;
+	    }
+	} else if (chain.size() > 1) {
+	    break;			// a caller that didn't save r31
+	}
+	if (ra == 0) {
+	    break;
+	}
+	sp += frameSize;
+	pc = ra - 8;			// the call, before its delay slot
+	ra = 0;
+    }
+    if (!chain.empty()) {
+	stacks[std::vector<int>(chain.rbegin(), chain.rend())]++;
+    }
+}
+
+//----------------------------------------------------------------------
+// Sampler::WriteAll
+// 	Write the folded stacks of every program we sampled to the file
+//	given to Start: "program;outer;...;inner count", one line per
+//	chain of calls.  Called at Halt.
+//----------------------------------------------------------------------
+
+void
+Sampler::WriteAll()
+{
+    std::map<std::vector<int>, int>::iterator it;
+    std::string line;
+    char count[16];
+    int fd, samples = 0;
+
+    if (outFileName == NULL) {
+	return;
+    }
+    fd = OpenForWrite(outFileName);
+    for (unsigned int p = 0; p < all.size(); p++) {
+	for (it = all[p]->stacks.begin(); it != all[p]->stacks.end(); it++) {
+	    line = all[p]->name;
+	    for (unsigned int f = 0; f < it->first.size(); f++) {
+		line += ";" + all[p]->symbols.AddressName(it->first[f]);
+	    }
+	    sprintf(count, " %d\n", it->second);
+	    line += count;
+	    WriteFile(fd, (char *) line.c_str(), line.size());
+	    samples += it->second;
+	}
+    }
+    Close(fd);
+    cout << "Samples: " << samples << ", written to " << outFileName << "\n";
+}
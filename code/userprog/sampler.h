@@ -0,0 +1,91 @@
+// sampler.h
+//	Data structures for the sampling profiler (nachos -sample).
+//
+//	Unlike -prof, which counts every instruction, this only looks at
+//	the user program that was running when the timer went off (every
+//	time, or every Nth time): where it was, and the chain of calls
+//	that got it there.  So it costs nothing between samples, and can
+//	be left on for long runs.
+//
+//	The calls are found the way a debugger does without debugging
+//	information: the prologue of each function (addiu sp,sp,-N and
+//	sw ra,M(sp)) says how big its frame is and where it saved its
+//	return address; a function that hasn't saved it yet still has it
+//	in r31.  The stack is read through the page table, without
+//	faulting anything in; a frame on a page that isn't in memory ends
+//	the chain.
+//
+//	At Halt, the samples are written out as "folded stacks": one line
+//	per distinct chain of calls, the program's name and then each
+//	function, outermost first, separated by ';', then the number of
+//	samples.  This is what flame graph tools read.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "machine.h"
+#include "openfile.h"
+#include "symbols.h"
+#include <vector>
+#include <map>
+#include <string>
+
+const int MaxSampleDepth = 32;	// most calls we follow back
+const int MaxPrologue = 32;	// how far into a function its prologue
+				// may go
+const int MaxFunctionSearch = 4096;
+				// without symbols, how far back to look
+				// for the start of a function
+
+// The samples of one program.  One is made each time a program is
+// loaded, and kept until Halt, even if the program exits first.
+
+class Sampler {
+  public:
+    Sampler(char *fileName, OpenFile *executable, int codeAddr,
+	    int codeSize, int inFileAddr);
+				// Start sampling the program in
+				// "fileName", whose code is at "codeAddr"
+    ~Sampler();
+
+    static void Start(char *outFileName, int every);
+				// Sample every "every" timer interrupts,
+				// and write the stacks to "outFileName"
+    static bool Sampling() { return outFileName != NULL; }
+    static void Tick();		// The timer went off in user mode
+    static void WriteAll();	// Write out the stacks of every program,
+				// at Halt
+
+  private:
+    void Sample(int pc, int sp, int ra);
+				// Follow the calls back from "pc", and
+				// count the chain
+    int FunctionStart(int i);	// Index of the first instruction of the
+				// function containing code[i]
+    bool ReadWord(int virtAddr, int *value);
+				// Read user memory, if it's in memory
+
+    std::string name;		// the program's file name
+    int codeAddr;		// virtual address of its first instruction
+    unsigned int numInstrs;	// # of instructions in its code
+    Instruction *code;		// its code, decoded
+    SymbolTable symbols;	// its functions
+    std::map<std::vector<int>, int> stacks;
+				// # of samples of each chain of calls,
+				// by the functions' addresses, outermost
+				// first
+
+    static char *outFileName;	// where to write the stacks, or NULL
+    static int every;		// timer interrupts per sample
+    static int ticks;		//   and since the last one
+    static std::vector<Sampler *> all;
+				// every program sampled, for WriteAll
+};
+
+#endif // SAMPLER_H
@@ -0,0 +1,116 @@
+// symbols.cc
+//	Routines to name the functions of a user program.  See symbols.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "symbols.h"
+#include "main.h"
+#include <algorithm>
+
+//----------------------------------------------------------------------
+// SymbolTable::Read
+// 	Read the functions of the program "programName" from the file
+//	coff2noff wrote next to it.  If the file isn't there, we do
+//	without.
+//----------------------------------------------------------------------
+
+void
+SymbolTable::Read(char *programName)
+{
+    char *symFileName = new char[strlen(programName) + 5];
+    OpenFile *file;
+    Symbol sym;
+    char *text, *line, *next;
+    char symName[80];
+    int length;
+    unsigned int i;
+
+    sprintf(symFileName, "%s.sym", programName);
+    file = kernel->fileSystem->Open(symFileName);
+    delete [] symFileName;
+    if (file == NULL) {
+	DEBUG(dbgAddr, "No symbols for " << programName);
+	return;
+    }
+    length = file->Length();
+    text = new char[length + 1];
+    file->ReadAt(text, length, 0);
+    text[length] = '\0';
+    delete file;
+
+    for (line = text; *line != '\0'; line = next) {
+	next = strchr(line, '\n');
+	if (next == NULL) {
+	    next = line + strlen(line);
+	} else {
+	    *next++ = '\0';
+	}
+	if (sscanf(line, "%x %79s", (unsigned int *) &sym.address, symName) == 2) {
+	    sym.name = symName;
+	    symbols.push_back(sym);
+	}
+    }
+    delete [] text;
+
+    // coff2noff lists global functions twice; keep one of each
+    std::stable_sort(symbols.begin(), symbols.end());
+    for (i = 1; i < symbols.size(); ) {
+	if (symbols[i].address == symbols[i - 1].address) {
+	    symbols.erase(symbols.begin() + i);
+	} else {
+	    i++;
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// SymbolTable::Find
+// 	Return the index of the function "address" is in: the last one
+//	starting at or before it.  -1 if there is none.
+//----------------------------------------------------------------------
+
+int
+SymbolTable::Find(int address)
+{
+    int low = 0, high = (int) symbols.size() - 1, mid;
+
+    if (high < 0 || address < symbols[0].address) {
+	return -1;
+    }
+    while (low < high) {		// symbols[low].address <= address
+	mid = (low + high + 1) / 2;
+	if (symbols[mid].address <= address) {
+	    low = mid;
+	} else {
+	    high = mid - 1;
+	}
+    }
+    return low;
+}
+
+//----------------------------------------------------------------------
+// SymbolTable::AddressName
+// 	Return "address" as "function+offset", or in hex if we don't know
+//	the function.
+//----------------------------------------------------------------------
+
+std::string
+SymbolTable::AddressName(int address)
+{
+    int s = Find(address);
+    char hex[16];
+
+    if (s == -1) {
+	sprintf(hex, "0x%x", address);
+	return hex;
+    } else if (address == symbols[s].address) {
+	return symbols[s].name;
+    } else {
+	sprintf(hex, "+0x%x", address - symbols[s].address);
+	return symbols[s].name + hex;
+    }
+}
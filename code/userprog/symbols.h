@@ -0,0 +1,50 @@
+// symbols.h
+//	Data structures to name the functions of a user program, for the
+//	profilers (nachos -prof and -sample).
+//
+//	coff2noff saves the symbol table of each program next to the
+//	NOFF file, in "<program>.sym": one line per function, its
+//	address in hex, then its name.  Without it, functions are just
+//	addresses.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include "copyright.h"
+#include "utility.h"
+#include <vector>
+#include <string>
+
+// The functions of one program, sorted by address
+
+class SymbolTable {
+  public:
+    SymbolTable() {}		// No functions, until Read
+
+    void Read(char *programName);
+				// Read "<programName>.sym", if it is there
+    int Find(int address);	// Index of the function containing
+				// "address", or -1 if there is none
+    int NumSymbols() { return symbols.size(); }
+    int Address(int i) { return symbols[i].address; }
+    const std::string &Name(int i) { return symbols[i].name; }
+				// The start and name of function "i"
+    std::string AddressName(int address);
+				// "function+0xoffset", or "0xaddress"
+
+  private:
+    class Symbol {
+      public:
+	int address;
+	std::string name;
+	bool operator<(const Symbol &s) const { return address < s.address; }
+    };
+
+    std::vector<Symbol> symbols;
+};
+
+#endif // SYMBOLS_H
@@ -40,6 +40,19 @@
 #define SC_Mul 32
 #define SC_Div 33
 #define SC_Mod 34
+#define SC_PerfCounter 35
+
+/* the counters PerfCounter can read, and whose */
+#define PerfInstructions 0	/* user instructions completed */
+#define PerfUserTicks	1	/* time running user code */
+#define PerfSystemTicks	2	/* time running the kernel */
+#define PerfPageFaults	3	/* page faults */
+#define PerfDiskReads	4	/* disk read requests */
+#define PerfDiskWrites	5	/*   and write requests */
+#define NumPerfCounters	6
+
+#define PerfProcess	0	/* just this program's */
+#define PerfGlobal	1	/* everyone's, since Nachos started */
 
 
 #ifndef IN_ASM
@@ -93,10 +106,15 @@ typedef int OpenFileId;
  * keyboard input and display output (in UNIX terms, stdin and stdout).
  * Read and Write can be used directly on these, without first opening
  * the console device.
+ *
+ * Not in the kernel, where ConsoleInput and ConsoleOutput are the
+ * console devices (console.h).
  */
 
+#ifndef USER_PROGRAM
 #define ConsoleInput	0  
 #define ConsoleOutput	1  
+#endif
  
 /* Create a Nachos file, with "name" */
 void Create(char *name);
@@ -140,7 +158,8 @@ void ThreadYield();
 
 void PrintInt(int number);	//my System Call
 
-void Sleep(int sec);
+/* Sleep for "ticks" ticks of simulated time (see stats.h) */
+void Sleep(int ticks);
 void Example(int number);
 
 int Add(int valR, int valL);
@@ -150,6 +169,16 @@ int Div(int valR, int valL);
 int Mod(int valR, int valL);
 
 int Print(const char* valR);
+
+/* Return the value of performance counter "counter" (PerfInstructions,
+ * ...), counted for this program alone ("scope" PerfProcess) or for the
+ * whole machine (PerfGlobal); -1 if there is no such counter.
+ * Read it before and after a part of the program to see what that 
+ * part cost.  The kernel counts in 64 bits; this is the low 32, so
+ * the difference of two reads is right even if the count wrapped
+ * between them.
+ */
+int PerfCounter(int counter, int scope);
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */
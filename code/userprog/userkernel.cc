@@ -10,6 +10,60 @@
 #include "synchconsole.h"
 #include "userkernel.h"
 #include "synchdisk.h"
+#include "profile.h"
+#include "sampler.h"
+#include "tlb.h"
+#include "tracewriter.h"
+#include "pipeline.h"
+#include "checkpoint.h"
+
+//----------------------------------------------------------------------
+// ParseCache
+// 	Read the shape of a cache from the command line: "argv" holds
+//	"sets ways lineSize lru|fifo|random".
+//----------------------------------------------------------------------
+
+static void
+ParseCache(char **argv, CacheGeometry *cache)
+{
+    cache->sets = atoi(argv[0]);
+    cache->ways = atoi(argv[1]);
+    cache->lineSize = atoi(argv[2]);
+    ASSERT(cache->sets > 0 && cache->ways > 0);
+    ASSERT(cache->lineSize >= 4 && (cache->lineSize & (cache->lineSize - 1)) == 0);
+    if (strcmp(argv[3], "fifo") == 0) {
+	cache->policy = FIFOReplace;
+    } else if (strcmp(argv[3], "random") == 0) {
+	cache->policy = RandomReplace;
+    } else {
+	ASSERT(strcmp(argv[3], "lru") == 0);
+	cache->policy = LRUReplace;
+    }
+}
+
+//----------------------------------------------------------------------
+// ParseTLB
+// 	Read the shape of the TLB from the command line: "argv" holds
+//	"entries ways lru|fifo|random".
+//----------------------------------------------------------------------
+
+static void
+ParseTLB(char **argv, CacheGeometry *tlb)
+{
+    int entries = atoi(argv[0]);
+
+    tlb->ways = atoi(argv[1]);
+    ASSERT(tlb->ways > 0 && entries >= tlb->ways && entries % tlb->ways == 0);
+    tlb->sets = entries / tlb->ways;
+    if (strcmp(argv[2], "fifo") == 0) {
+	tlb->policy = FIFOReplace;
+    } else if (strcmp(argv[2], "random") == 0) {
+	tlb->policy = RandomReplace;
+    } else {
+	ASSERT(strcmp(argv[2], "lru") == 0);
+	tlb->policy = LRUReplace;
+    }
+}
 
 //----------------------------------------------------------------------
 // UserProgKernel::UserProgKernel
@@ -20,6 +74,26 @@
 UserProgKernel::UserProgKernel(int argc, char **argv) 
 		: ThreadedKernel(argc, argv) {
     debugUserProg = FALSE;
+    engine = DefaultEngine;
+    parallel = FALSE;
+    profiling = FALSE;
+    iCache.sets = dCache.sets = 0;
+#ifdef USE_TLB
+    tlbShape.sets = 1;			// TLBSize entries, any of which 
+    tlbShape.ways = TLBSize;		// can hold any page, replaced at
+    tlbShape.policy = RandomReplace;	// random, as on the R2000
+#else
+    tlbShape.sets = 0;			// translate with the page table
+#endif
+    cacheHitTime = CacheHitTime;
+    cacheMissTime = CacheMissTime;
+    memTraceFile = NULL;
+    pipelined = FALSE;
+    loadLatency = LoadLatency;
+    multLatency = MultLatency;
+    divLatency = DivLatency;
+    branchPenalty = BranchPenalty;
+    restoreFile = NULL;
 	execfileNum=0;
     for (int i = 1; i < argc; i++) {
 		if (strcmp(argv[i], "-s") == 0) {
@@ -44,6 +118,20 @@ UserProgKernel::UserProgKernel(int argc, char **argv)
 			cout << "Partial usage: nachos [-s]\n";
 			cout << "Partial usage: nachos [-u]" << endl;
 			cout << "Partial usage: nachos [-e] filename" << endl;
+			cout << "Partial usage: nachos [-engine switch|threaded|block]" << endl;
+			cout << "Partial usage: nachos [-parallel]" << endl;
+			cout << "Partial usage: nachos [-prof]" << endl;
+			cout << "Partial usage: nachos [-sample filename every]" << endl;
+			cout << "Partial usage: nachos [-icache|-dcache sets ways linesize lru|fifo|random]" << endl;
+			cout << "Partial usage: nachos [-cachetime hit miss]" << endl;
+			cout << "Partial usage: nachos [-tlb entries ways lru|fifo|random]" << endl;
+			cout << "Partial usage: nachos [-mem pages]" << endl;
+			cout << "Partial usage: nachos [-disk tracks sectors]" << endl;
+			cout << "Partial usage: nachos [-pipeline]" << endl;
+			cout << "Partial usage: nachos [-pipetime load mult div branch]" << endl;
+			cout << "Partial usage: nachos [-memtrace filename]" << endl;
+			cout << "Partial usage: nachos [-checkpoint filename tick]" << endl;
+			cout << "Partial usage: nachos [-restore filename]" << endl;
 		} else if (strcmp(argv[i], "-h") == 0) {
 			cout << "argument 's' is for debugging. Machine status  will be printed " << endl;
 			cout << "argument 'e' is for execting file." << endl;
@@ -51,6 +139,74 @@ UserProgKernel::UserProgKernel(int argc, char **argv)
 			cout << "For example:" << endl;
 			cout << "	./nachos -s : Print machine status during the machine is on." << endl;
 			cout << "	./nachos -e file1 -e file2 : executing file1 and file2."  << endl;
+		} else if (strcmp(argv[i], "-engine") == 0) {
+			ASSERT(i + 1 < argc);
+			if (strcmp(argv[i + 1], "threaded") == 0) {
+				engine = ThreadedEngine;
+			} else if (strcmp(argv[i + 1], "block") == 0) {
+				engine = BlockEngine;
+			} else {
+				ASSERT(strcmp(argv[i + 1], "switch") == 0);
+				engine = SwitchEngine;
+			}
+			i++;
+		} else if (strcmp(argv[i], "-parallel") == 0) {
+			parallel = TRUE;
+		} else if (strcmp(argv[i], "-prof") == 0) {
+			profiling = TRUE;
+		} else if (strcmp(argv[i], "-sample") == 0) {
+			ASSERT(i + 2 < argc);
+			Sampler::Start(argv[i + 1], atoi(argv[i + 2]));
+			i += 2;
+		} else if (strcmp(argv[i], "-icache") == 0) {
+			ASSERT(i + 4 < argc);
+			ParseCache(&argv[i + 1], &iCache);
+			i += 4;
+		} else if (strcmp(argv[i], "-dcache") == 0) {
+			ASSERT(i + 4 < argc);
+			ParseCache(&argv[i + 1], &dCache);
+			i += 4;
+		} else if (strcmp(argv[i], "-tlb") == 0) {
+			ASSERT(i + 3 < argc);
+			ParseTLB(&argv[i + 1], &tlbShape);
+			i += 3;
+		} else if (strcmp(argv[i], "-mem") == 0) {
+			ASSERT(i + 1 < argc);
+			SetMemorySize(atoi(argv[i + 1]));
+			i++;
+		} else if (strcmp(argv[i], "-disk") == 0) {
+			ASSERT(i + 2 < argc);
+			SetDiskGeometry(atoi(argv[i + 1]), atoi(argv[i + 2]));
+			i += 2;
+		} else if (strcmp(argv[i], "-cachetime") == 0) {
+			ASSERT(i + 2 < argc);
+			cacheHitTime = atoi(argv[i + 1]);
+			cacheMissTime = atoi(argv[i + 2]);
+			ASSERT(cacheHitTime >= 0 && cacheMissTime >= 0);
+			i += 2;
+		} else if (strcmp(argv[i], "-pipeline") == 0) {
+			pipelined = TRUE;
+		} else if (strcmp(argv[i], "-pipetime") == 0) {
+			ASSERT(i + 4 < argc);
+			loadLatency = atoi(argv[i + 1]);
+			multLatency = atoi(argv[i + 2]);
+			divLatency = atoi(argv[i + 3]);
+			branchPenalty = atoi(argv[i + 4]);
+			ASSERT(loadLatency >= 1 && multLatency >= 1 
+			       && divLatency >= 1 && branchPenalty >= 0);
+			i += 4;
+		} else if (strcmp(argv[i], "-memtrace") == 0) {
+			ASSERT(i + 1 < argc);
+			memTraceFile = argv[i + 1];
+			i++;
+		} else if (strcmp(argv[i], "-checkpoint") == 0) {
+			ASSERT(i + 2 < argc);
+			Checkpoint::Request(argv[i + 1], atoll(argv[i + 2]));
+			i += 2;
+		} else if (strcmp(argv[i], "-restore") == 0) {
+			ASSERT(i + 1 < argc);
+			restoreFile = argv[i + 1];
+			i++;
 		} else if(strcmp(argv[i], "-FIFO") == 0){
             AddrSpace::SwapMethod = FIFO;
         } else if(strcmp(argv[i], "-LRU") == 0){
@@ -68,7 +224,34 @@ void
 UserProgKernel::Initialize() {
     ThreadedKernel::Initialize();	// init multithreading
 
-    machine = new Machine(debugUserProg);
+    machine = new Machine(debugUserProg, engine);
+    machine->profiling = profiling;
+    if (iCache.sets > 0) {
+	machine->icache = new Cache(iCache.sets, iCache.ways, iCache.lineSize,
+			iCache.policy, cacheHitTime, cacheMissTime, &stats->iCache);
+    }
+    if (dCache.sets > 0) {
+	machine->dcache = new Cache(dCache.sets, dCache.ways, dCache.lineSize,
+			dCache.policy, cacheHitTime, cacheMissTime, &stats->dCache);
+    }
+    if (tlbShape.sets > 0) {
+	machine->tlb = new TLB(tlbShape.sets, tlbShape.ways, tlbShape.policy,
+			       &stats->tlb);
+    }
+    if (pipelined) {
+	machine->pipeline = new Pipeline(loadLatency, multLatency, divLatency,
+					 branchPenalty, &stats->pipeline);
+    }
+    if (memTraceFile != NULL) {
+	machine->memTrace = new MemTraceWriter(memTraceFile);
+    }
+    // The rounds run on host threads can't print the per-tick and
+    // per-switch debug messages, or be traced; run those serially.
+    if (parallel && scheduler->NumCpus() > 1 
+	&& !debug->IsEnabled(dbgInt) && !debug->IsEnabled(dbgThread)
+	&& machine->StartParallel(scheduler->NumCpus())) {
+	scheduler->SetParallel(TRUE);
+    }
     fileSystem = new FileSystem();
 	SwapDisk = new SynchDisk("new Swap Disk");
 #ifdef FILESYS
@@ -83,6 +266,8 @@ UserProgKernel::Initialize() {
 //----------------------------------------------------------------------
 
 UserProgKernel::~UserProgKernel() {
+    Profile::PrintAll();		// after the statistics, with -prof
+    Sampler::WriteAll();		// with -sample
     delete fileSystem;
     delete machine;
 	delete SwapDisk;
@@ -101,6 +286,10 @@ void ForkExecute(Thread *t) {
 
 void UserProgKernel::Run() {
 
+	if (restoreFile != NULL) {	// the programs are in the checkpoint
+		Checkpoint::Restore(restoreFile);
+		execfileNum = 0;
+	}
 	cout << "Total threads number is " << execfileNum << endl;
 	for (int n=1;n<=execfileNum;n++) {
 		t[n] = new Thread(execfile[n]);
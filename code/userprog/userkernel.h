@@ -16,6 +16,7 @@
 #include "filesys.h"
 #include "machine.h"
 #include "synchdisk.h"
+#include "cache.h"
 class SynchDisk;
 class UserProgKernel : public ThreadedKernel {
   public:
@@ -40,6 +41,22 @@ class UserProgKernel : public ThreadedKernel {
 
   private:
     bool debugUserProg;		// single step user program
+    EngineType engine;		// instruction interpreter to use
+    bool parallel;		// run simulated processors on host threads
+    bool profiling;		// profile user programs by PC
+    CacheGeometry iCache;	// the caches to simulate, if any
+    CacheGeometry dCache;
+    CacheGeometry tlbShape;	// the TLB, if any (its lineSize is unused)
+    int cacheHitTime;		// ticks for a cache hit
+    int cacheMissTime;		//   for a miss, or a write-back
+    char *memTraceFile;		// where to record memory references,
+				// or NULL
+    bool pipelined;		// time instructions with the pipeline
+    int loadLatency;		//   cycles until the result of a load,
+    int multLatency;		//   a mult, a div is ready,
+    int divLatency;
+    int branchPenalty;		//   and lost to a taken branch
+    char *restoreFile;		// checkpoint to start from, or NULL
     Thread* t[10];
     char* execfile[10];
     int priority[10];